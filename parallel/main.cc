@@ -25,6 +25,7 @@ struct config {
   int task;
   int backend;
   int : 32;
+  std::string output;
 
   config() {
     seed = 1;
@@ -43,6 +44,7 @@ struct config {
       {"time", 1, 0, 0},
       {"task", 1, 0, 0},
       {"backend", 1, 0, 0},
+      {"output", 1, 0, 0},
       {nullptr, 0, nullptr, 0}  // sentinel
     };
 
@@ -58,6 +60,7 @@ struct config {
           if (option_index == 3) time = atof(optarg);
           if (option_index == 4) task = atoi(optarg);
           if (option_index == 5) backend = atoi(optarg);
+          if (option_index == 6) output = optarg;
         }
       }
     }
@@ -112,13 +115,32 @@ int main(int argc, char** argv) {
   #endif
 
   //
+  dt::bench_report report("parallel");
   auto sc = cfg.task == 1? scenptr(new scenario1(cfg.n, cfg.seed)) :
             cfg.task == 2? scenptr(new scenario2(cfg.n)) :
+            cfg.task == 3? scenptr(new scenario3(cfg.n, cfg.seed)) :
+            cfg.task == 4? scenptr(new scenario4(cfg.n, cfg.seed, false)) :
+            cfg.task == 5? scenptr(new scenario4(cfg.n, cfg.seed, true)) :
+            cfg.task == 6? scenptr(new scenario5(cfg.n, cfg.seed, false)) :
+            cfg.task == 7? scenptr(new scenario5(cfg.n, cfg.seed, true)) :
+            cfg.task == 8? scenptr(new scenario6(cfg.n, cfg.seed)) :
+            cfg.task == 9? scenptr(new scenario7(cfg.n, cfg.seed)) :
+            cfg.task == 10? scenptr(new scenario8(cfg.n, cfg.seed)) :
+            cfg.task == 11? scenptr(new scenario9(cfg.n, cfg.seed, false)) :
+            cfg.task == 12? scenptr(new scenario9(cfg.n, cfg.seed, true)) :
             scenptr(nullptr);
   if (sc) {
     sc->set_nthreads(cfg.nthreads);
     sc->set_max_time(cfg.time);
     sc->set_backends(cfg.backend);
+    sc->set_report(&report);
     sc->benchmark();
   }
+  if (!cfg.output.empty()) {
+    if (report.save(cfg.output)) {
+      std::cout << "Results saved into " << cfg.output << "\n";
+    } else {
+      std::cout << "Unable to write file " << cfg.output << "\n";
+    }
+  }
 }
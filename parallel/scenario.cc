@@ -8,13 +8,19 @@
 #include "thpool1/thread_pool.h"
 #include "thpool2/thread_pool.h"
 #include "thpool3/thread_pool.h"
+#include "utils/perf_counters.h"
 #include "scenario.h"
 
+// Constructed before any of the thread pools spawn their workers, so that
+// the counters include the work done in all threads.
+static dt::perf_counters perf;
+
 
 scenario::scenario() {
   max_time = 1.0;
   nthreads = dt1::get_hardware_concurrency();
   backends = Backend::OMP | Backend::TP1 | Backend::TP2 | Backend::TP3;
+  report = nullptr;
 }
 
 scenario::~scenario() {}
@@ -31,9 +37,25 @@ void scenario::set_max_time(double t) {
   max_time = t;
 }
 
+void scenario::set_report(dt::bench_report* r) {
+  report = r;
+}
+
 void scenario::setup() {}
 void scenario::teardown() {}
 
+int scenario::available_backends() {
+  return Backend::OMP | Backend::TP1 | Backend::TP2 | Backend::TP3;
+}
+
+std::vector<scenario::variant> scenario::thpool3_variants() {
+  return {};
+}
+
+std::vector<scenario::variant> scenario::omp_variants() {
+  return {};
+}
+
 
 template <typename F>
 static double timeit(F fun) {
@@ -45,20 +67,26 @@ static double timeit(F fun) {
 }
 
 
+// Returns the durations of all runs, in seconds
 template <typename F>
-static void benchmarkit(const std::string& backend_name, F fun,
-                        double max_runtime = 1.0)
+static std::vector<double> benchmarkit(const std::string& backend_name, F fun,
+                                       double max_runtime = 1.0)
 {
   std::cout << "  \x1B[1m" << backend_name << "\x1B[m: ";
   std::vector<double> durations;
   double total_time = 0.0;
   int n_runs = 0;
+  perf.reset();
+  perf.start();
   while (total_time < max_runtime) {
     double duration = timeit(fun);
     durations.push_back(duration);
     total_time += duration;
     n_runs ++;
   }
+  perf.stop();
+  std::string counters = perf.summary(n_runs);
+  std::vector<double> samples(durations);
   std::sort(durations.begin(), durations.end());
   if (n_runs >= 10) {
     n_runs = static_cast<size_t>(n_runs * 0.95);
@@ -95,6 +123,10 @@ static void benchmarkit(const std::string& backend_name, F fun,
             << ", max=" << max_time << units
             << ", n=" << n_runs
             << ")\n";
+  if (!counters.empty()) {
+    std::cout << "           " << counters << "\n";
+  }
+  return samples;
 }
 
 
@@ -156,32 +188,52 @@ static void stop_thpool3() {
 
 void scenario::benchmark() {
   std::cout << "Benchmarking [nthreads=" << nthreads << "] " << name() << "\n";
+  std::string scenario_name = name();
+  int backends = this->backends & available_backends();
+  auto record = [&](const std::string& backend,
+                    const std::vector<double>& samples) {
+    if (!report) return;
+    report->add(scenario_name, {{"backend", backend},
+                                {"nthreads", std::to_string(nthreads)}},
+                samples);
+  };
   if (backends & Backend::TP3) {
     startup_thpool3();
     setup();
-    benchmarkit("ThPool3", [&]{ run_thpool3(); }, max_time);
+    record("thpool3", benchmarkit("ThPool3", [&]{ run_thpool3(); }, max_time));
     teardown();
+    for (const variant& v : thpool3_variants()) {
+      setup();
+      record("thpool3/" + v.name,
+             benchmarkit("ThPool3/" + v.name, v.run, max_time));
+      teardown();
+    }
     stop_thpool3();
   }
   if (backends & Backend::TP2) {
     startup_thpool2();
     setup();
-    benchmarkit("ThPool2", [&]{ run_thpool2(); }, max_time);
+    record("thpool2", benchmarkit("ThPool2", [&]{ run_thpool2(); }, max_time));
     teardown();
     stop_thpool2();
   }
   if (backends & Backend::TP1) {
     startup_thpool1();
     setup();
-    benchmarkit("ThPool1", [&]{ run_thpool1(); }, max_time);
+    record("thpool1", benchmarkit("ThPool1", [&]{ run_thpool1(); }, max_time));
     teardown();
     stop_thpool1();
   }
   if (backends & Backend::OMP) {
     startup_omp();
     setup();
-    benchmarkit("OMP    ", [&]{ run_omp(); }, max_time);
+    record("omp", benchmarkit("OMP    ", [&]{ run_omp(); }, max_time));
     teardown();
+    for (const variant& v : omp_variants()) {
+      setup();
+      record("omp/" + v.name, benchmarkit("OMP/" + v.name, v.run, max_time));
+      teardown();
+    }
   }
 }
 
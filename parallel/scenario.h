@@ -1,6 +1,7 @@
 #ifndef SCENARIO_h
 #define SCENARIO_h
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,6 +9,7 @@
 #include "thpool1/api.h"
 #include "thpool2/api.h"
 #include "thpool3/api.h"
+#include "utils/bench_report.h"
 
 enum Backend {
   OMP = 1,
@@ -22,6 +24,7 @@ class scenario {
     double max_time;
     int nthreads;
     int backends;
+    dt::bench_report* report;
 
   public:
     scenario();
@@ -30,6 +33,7 @@ class scenario {
     void set_nthreads(int nth);
     void set_backends(int);
     void set_max_time(double t);
+    void set_report(dt::bench_report* r);
     virtual void setup();
     void benchmark();
     virtual void teardown();
@@ -40,6 +44,22 @@ class scenario {
     virtual void run_thpool1() = 0;
     virtual void run_thpool2() = 0;
     virtual void run_thpool3() = 0;
+
+    // Backends that this scenario can run on. Scenarios that exercise
+    // functionality which only exists in thpool3 skip the older pools.
+    virtual int available_backends();
+
+    // Alternative thpool3 implementations of the scenario, benchmarked
+    // together with `run_thpool3()`. The default is none.
+    struct variant {
+      std::string name;
+      std::function<void()> run;
+    };
+    virtual std::vector<variant> thpool3_variants();
+
+    // Alternative OpenMP implementations, benchmarked together with
+    // `run_omp()`. The default is none.
+    virtual std::vector<variant> omp_variants();
 };
 
 using scenptr = std::unique_ptr<scenario>;
@@ -89,4 +109,162 @@ class scenario2 : public scenario {
 };
 
 
+class scenario3 : public scenario {
+  private:
+    std::vector<double> input_data;
+    std::vector<int32_t> output_rows;
+
+  public:
+    scenario3(size_t n, size_t seed);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+};
+
+
+class scenario4 : public scenario {
+  protected:
+    std::vector<double> input_data;
+    std::vector<double> output_data;
+    std::vector<int> cost;
+    bool imbalanced;
+    size_t : 56;
+
+  public:
+    scenario4(size_t n, size_t seed, bool imbalanced);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+    std::vector<variant> thpool3_variants() override;
+
+    void compute(size_t i);
+};
+
+
+
+// Same work as scenario4, comparing the scheduling policies of
+// `dt3::parallel_for_dynamic()` with OpenMP's `schedule(guided)`.
+class scenario5 : public scenario4 {
+  public:
+    scenario5(size_t n, size_t seed, bool imbalanced);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool3() override;
+    std::vector<variant> thpool3_variants() override;
+};
+
+
+
+// Nested parallelism: a dynamic loop over groups of very different sizes,
+// where each group is processed with an inner parallel loop.
+class scenario6 : public scenario {
+  private:
+    std::vector<double> input_data;
+    std::vector<double> output_data;
+    std::vector<size_t> offsets;
+
+  public:
+    scenario6(size_t n, size_t seed);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+    std::vector<variant> thpool3_variants() override;
+    std::vector<variant> omp_variants() override;
+
+    size_t ngroups() const;
+    void compute(size_t i);
+};
+
+
+
+// Fork-join recursion: quicksort where both halves of every partition are
+// sorted as separate tasks.
+class scenario7 : public scenario {
+  private:
+    std::vector<double> input_data;
+    std::vector<double> output_data;
+
+  public:
+    scenario7(size_t n, size_t seed);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+
+    void quicksort_omp(size_t i0, size_t i1);
+    void quicksort_tp3(size_t i0, size_t i1);
+};
+
+
+
+// Reductions: the sum and the variance of X.
+class scenario8 : public scenario {
+  private:
+    std::vector<double> input_data;
+    double result;
+    size_t : 64;
+
+  public:
+    scenario8(size_t n, size_t seed);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+    std::vector<variant> thpool3_variants() override;
+    std::vector<variant> omp_variants() override;
+};
+
+
+
+// Prefix sums (inclusive scan) of X, either of doubles or of 64-bit integers.
+class scenario9 : public scenario {
+  private:
+    std::vector<double> real_input, real_output;
+    std::vector<int64_t> int_input, int_output;
+    bool integer;
+    size_t : 56;
+
+  public:
+    scenario9(size_t n, size_t seed, bool integer);
+
+  protected:
+    std::string name() override;
+    void run_omp() override;
+    void run_thpool1() override;
+    void run_thpool2() override;
+    void run_thpool3() override;
+    int available_backends() override;
+    std::vector<variant> thpool3_variants() override;
+    std::vector<variant> omp_variants() override;
+
+    template <typename T>
+    void scan_omp(const std::vector<T>& src, std::vector<T>& dst);
+};
+
+
 #endif
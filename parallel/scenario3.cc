@@ -0,0 +1,78 @@
+#include <random>
+#include <sstream>
+#include "scenario.h"
+
+
+scenario3::scenario3(size_t n, size_t seed) {
+  input_data.resize(n);
+
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  std::normal_distribution<> normal_distribution(0.0);
+
+  for (size_t i = 0; i < n; ++i) {
+    input_data[i] = normal_distribution(gen);
+  }
+}
+
+
+std::string scenario3::name() {
+  std::ostringstream ss;
+  ss << "Filtering rows where X > 0, where X.size = " << input_data.size();
+  return ss.str();
+}
+
+
+int scenario3::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+// The usual way of writing a filter with OpenMP: each thread counts the
+// matching rows in its static range, then after the offsets of all threads
+// are known it scans its range once more to write the rows out.
+void scenario3::run_omp() {
+  size_t n = input_data.size();
+  const double* inputs = input_data.data();
+  std::vector<size_t> counts(static_cast<size_t>(nthreads) + 1);
+  std::vector<int32_t> rows;
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    size_t ith = static_cast<size_t>(omp_get_thread_num());
+    size_t nth = static_cast<size_t>(omp_get_num_threads());
+    size_t i0 = n * ith / nth;
+    size_t i1 = n * (ith + 1) / nth;
+    size_t count = 0;
+    for (size_t i = i0; i < i1; ++i) {
+      count += (inputs[i] > 0);
+    }
+    counts[ith + 1] = count;
+    #pragma omp barrier
+    #pragma omp single
+    {
+      for (size_t t = 0; t < nth; ++t) counts[t + 1] += counts[t];
+      rows.resize(counts[nth]);
+    }
+    int32_t* out = rows.data() + counts[ith];
+    for (size_t i = i0; i < i1; ++i) {
+      if (inputs[i] > 0) *out++ = static_cast<int32_t>(i);
+    }
+  }
+  output_rows.swap(rows);
+}
+
+
+void scenario3::run_thpool1() {}
+void scenario3::run_thpool2() {}
+
+
+void scenario3::run_thpool3() {
+  const double* inputs = input_data.data();
+
+  output_rows = dt3::parallel_filter(
+    /* nrows = */ input_data.size(),
+    /* nthreads = */ static_cast<size_t>(nthreads),
+    [=](size_t i) {
+      return inputs[i] > 0;
+    });
+}
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <random>
+#include <sstream>
+#include "scenario.h"
+
+
+// In the imbalanced version of the scenario the first 1% of iterations are
+// this many times more expensive than the rest. They all fall into the
+// first thread's share of a static schedule.
+static constexpr int HEAVY_COST = 200;
+
+
+scenario4::scenario4(size_t n, size_t seed, bool imbalanced_)
+  : imbalanced(imbalanced_)
+{
+  input_data.resize(n);
+  output_data.resize(n);
+  cost.resize(n, 1);
+
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  std::normal_distribution<> normal_distribution(0.0);
+
+  for (size_t i = 0; i < n; ++i) {
+    input_data[i] = normal_distribution(gen);
+  }
+  if (imbalanced) {
+    for (size_t i = 0; i < n / 100; ++i) cost[i] = HEAVY_COST;
+  }
+}
+
+
+std::string scenario4::name() {
+  std::ostringstream ss;
+  ss << "Dynamic loop over " << (imbalanced? "imbalanced" : "uniform")
+     << " work, where X.size = " << input_data.size();
+  return ss.str();
+}
+
+
+int scenario4::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+void scenario4::compute(size_t i) {
+  double x = input_data[i];
+  double r = 0;
+  for (int j = cost[i]; j > 0; --j) {
+    r += std::sin(x * j);
+  }
+  output_data[i] = r;
+}
+
+
+void scenario4::run_omp() {
+  size_t n = input_data.size();
+
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+  for (size_t i = 0; i < n; ++i) {
+    compute(i);
+  }
+}
+
+
+void scenario4::run_thpool1() {}
+void scenario4::run_thpool2() {}
+
+
+void scenario4::run_thpool3() {
+  dt3::parallel_for_dynamic(
+    /* nrows = */ input_data.size(),
+    /* nthreads = */ static_cast<size_t>(nthreads),
+    [&](size_t i) {
+      compute(i);
+    });
+}
+
+
+std::vector<scenario::variant> scenario4::thpool3_variants() {
+  return {
+    // Within a parallel region `parallel_for_dynamic()` hands out the
+    // iterations one at a time from a single shared counter.
+    {"shared", [&] {
+      dt3::parallel_region(static_cast<size_t>(nthreads),
+        [&] {
+          dt3::parallel_for_dynamic(
+            input_data.size(), dt3::num_threads_in_team(),
+            [&](size_t i) {
+              compute(i);
+            });
+        });
+    }},
+  };
+}
@@ -0,0 +1,52 @@
+#include <sstream>
+#include "scenario.h"
+
+
+scenario5::scenario5(size_t n, size_t seed, bool imbalanced_)
+  : scenario4(n, seed, imbalanced_) {}
+
+
+std::string scenario5::name() {
+  std::ostringstream ss;
+  ss << "Guided loop over " << (imbalanced? "imbalanced" : "uniform")
+     << " work, where X.size = " << input_data.size();
+  return ss.str();
+}
+
+
+void scenario5::run_omp() {
+  size_t n = input_data.size();
+
+  #pragma omp parallel for schedule(guided) num_threads(nthreads)
+  for (size_t i = 0; i < n; ++i) {
+    compute(i);
+  }
+}
+
+
+void scenario5::run_thpool3() {
+  dt3::parallel_for_dynamic(
+    /* nrows = */ input_data.size(),
+    /* nthreads = */ static_cast<size_t>(nthreads),
+    /* schedule = */ dt3::dynamic_schedule::guided(),
+    [&](size_t i) {
+      compute(i);
+    });
+}
+
+
+std::vector<scenario::variant> scenario5::thpool3_variants() {
+  auto run = [&](dt3::dynamic_schedule schedule) {
+    dt3::parallel_for_dynamic(
+      input_data.size(), static_cast<size_t>(nthreads), schedule,
+      [&](size_t i) {
+        compute(i);
+      });
+  };
+  return {
+    {"chunked1",  [=] { run(dt3::dynamic_schedule::chunked(1)); }},
+    {"chunked64", [=] { run(dt3::dynamic_schedule::chunked(64)); }},
+    {"adaptive",  [=] { run(dt3::dynamic_schedule::adaptive()); }},
+    {"stealing",  [=] { run(dt3::dynamic_schedule::stealing()); }},
+  };
+}
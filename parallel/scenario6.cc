@@ -0,0 +1,152 @@
+#include <cmath>
+#include <random>
+#include <sstream>
+#include "scenario.h"
+
+
+// Number of groups; the size of group `g` is proportional to 1/(g+1), so
+// the first few groups hold most of the rows.
+static constexpr size_t NGROUPS = 256;
+
+// Cost of processing a single row, in calls to sin().
+static constexpr int ROW_COST = 16;
+
+// Minimum number of rows per chunk of the inner loops.
+static constexpr size_t INNER_CHUNK = 256;
+
+
+scenario6::scenario6(size_t n, size_t seed) {
+  input_data.resize(n);
+  output_data.resize(n);
+
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  std::normal_distribution<> normal_distribution(0.0);
+
+  for (size_t i = 0; i < n; ++i) {
+    input_data[i] = normal_distribution(gen);
+  }
+
+  double harmonic = 0;
+  for (size_t g = 0; g < NGROUPS; ++g) harmonic += 1.0 / (g + 1);
+  double cumsum = 0;
+  offsets.push_back(0);
+  for (size_t g = 0; g < NGROUPS; ++g) {
+    cumsum += 1.0 / (g + 1);
+    offsets.push_back(static_cast<size_t>(n * (cumsum / harmonic)));
+  }
+  offsets.back() = n;
+}
+
+
+std::string scenario6::name() {
+  std::ostringstream ss;
+  ss << "Nested loops over " << NGROUPS << " skewed groups, where X.size = "
+     << input_data.size();
+  return ss.str();
+}
+
+
+int scenario6::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+size_t scenario6::ngroups() const {
+  return offsets.size() - 1;
+}
+
+
+void scenario6::compute(size_t i) {
+  double x = input_data[i];
+  double r = 0;
+  for (int j = ROW_COST; j > 0; --j) {
+    r += std::sin(x * j);
+  }
+  output_data[i] = r;
+}
+
+
+// Nested parallel regions with the default limits: the inner team has
+// `nthreads` threads of its own, so the machine is oversubscribed whenever
+// several groups run at once.
+void scenario6::run_omp() {
+  size_t ng = ngroups();
+  int levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(2);
+
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+  for (size_t g = 0; g < ng; ++g) {
+    size_t i0 = offsets[g], i1 = offsets[g + 1];
+    #pragma omp parallel for num_threads(nthreads)
+    for (size_t i = i0; i < i1; ++i) {
+      compute(i);
+    }
+  }
+  omp_set_max_active_levels(levels);
+}
+
+
+void scenario6::run_thpool1() {}
+void scenario6::run_thpool2() {}
+
+
+// The inner loops are nested regions: they run on the threads of the pool
+// that are idle at the time, together with the thread that started them.
+void scenario6::run_thpool3() {
+  dt3::parallel_for_dynamic(
+    /* nrows = */ ngroups(),
+    /* nthreads = */ static_cast<size_t>(nthreads),
+    [&](size_t g) {
+      size_t i0 = offsets[g];
+      dt3::parallel_for_static(offsets[g + 1] - i0, INNER_CHUNK,
+                               static_cast<size_t>(nthreads),
+        [&](size_t i) {
+          compute(i0 + i);
+        });
+    });
+}
+
+
+std::vector<scenario::variant> scenario6::thpool3_variants() {
+  return {
+    // Parallelism over the groups only.
+    {"serial-inner", [&] {
+      dt3::parallel_for_dynamic(ngroups(), static_cast<size_t>(nthreads),
+        [&](size_t g) {
+          for (size_t i = offsets[g]; i < offsets[g + 1]; ++i) {
+            compute(i);
+          }
+        });
+    }},
+  };
+}
+
+
+std::vector<scenario::variant> scenario6::omp_variants() {
+  return {
+    // Tasks instead of nested teams: both levels are taskloops executed by
+    // a single team of `nthreads` threads.
+    {"taskloop", [&] {
+      size_t ng = ngroups();
+      #pragma omp parallel num_threads(nthreads)
+      #pragma omp single
+      #pragma omp taskloop grainsize(1)
+      for (size_t g = 0; g < ng; ++g) {
+        size_t i0 = offsets[g], i1 = offsets[g + 1];
+        #pragma omp taskloop grainsize(INNER_CHUNK)
+        for (size_t i = i0; i < i1; ++i) {
+          compute(i);
+        }
+      }
+    }},
+    {"serial-inner", [&] {
+      size_t ng = ngroups();
+      #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+      for (size_t g = 0; g < ng; ++g) {
+        for (size_t i = offsets[g]; i < offsets[g + 1]; ++i) {
+          compute(i);
+        }
+      }
+    }},
+  };
+}
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include "scenario.h"
+
+
+// Ranges smaller than this are sorted with std::sort, without spawning
+// any more tasks.
+static constexpr size_t SERIAL_CUTOFF = 4096;
+
+
+scenario7::scenario7(size_t n, size_t seed) {
+  input_data.resize(n);
+  output_data.resize(n);
+
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  std::normal_distribution<> normal_distribution(0.0);
+
+  for (size_t i = 0; i < n; ++i) {
+    input_data[i] = normal_distribution(gen);
+  }
+}
+
+
+std::string scenario7::name() {
+  std::ostringstream ss;
+  ss << "Recursive quicksort, where X.size = " << input_data.size();
+  return ss.str();
+}
+
+
+int scenario7::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+// Partition [i0, i1) of `x` around the median of three elements; returns
+// the bounds of the elements equal to the pivot.
+static std::pair<size_t, size_t> partition3(double* x, size_t i0, size_t i1) {
+  double a = x[i0], b = x[(i0 + i1) / 2], c = x[i1 - 1];
+  double pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+  double* lo = std::partition(x + i0, x + i1,
+                              [=](double v) { return v < pivot; });
+  double* hi = std::partition(lo, x + i1,
+                              [=](double v) { return v == pivot; });
+  return {static_cast<size_t>(lo - x), static_cast<size_t>(hi - x)};
+}
+
+
+void scenario7::quicksort_omp(size_t i0, size_t i1) {
+  double* x = output_data.data();
+  if (i1 - i0 <= SERIAL_CUTOFF) {
+    std::sort(x + i0, x + i1);
+    return;
+  }
+  auto mid = partition3(x, i0, i1);
+  #pragma omp task
+  quicksort_omp(i0, mid.first);
+  quicksort_omp(mid.second, i1);
+  #pragma omp taskwait
+}
+
+
+void scenario7::quicksort_tp3(size_t i0, size_t i1) {
+  double* x = output_data.data();
+  if (i1 - i0 <= SERIAL_CUTOFF) {
+    std::sort(x + i0, x + i1);
+    return;
+  }
+  auto mid = partition3(x, i0, i1);
+  dt3::task_group tg;
+  tg.spawn([=] { quicksort_tp3(i0, mid.first); });
+  quicksort_tp3(mid.second, i1);
+  tg.wait();
+}
+
+
+void scenario7::run_omp() {
+  output_data = input_data;
+  #pragma omp parallel num_threads(nthreads)
+  #pragma omp single
+  quicksort_omp(0, output_data.size());
+}
+
+
+void scenario7::run_thpool1() {}
+void scenario7::run_thpool2() {}
+
+
+// From the master thread the tasks start when `wait()` is called, so the
+// recursion itself is put into a task.
+void scenario7::run_thpool3() {
+  output_data = input_data;
+  dt3::task_group tg;
+  tg.spawn([&] { quicksort_tp3(0, output_data.size()); });
+  tg.wait();
+}
@@ -0,0 +1,96 @@
+#include <random>
+#include <sstream>
+#include "scenario.h"
+#include "thpool3/atomic.h"
+
+
+scenario8::scenario8(size_t n, size_t seed) : result(0) {
+  input_data.resize(n);
+
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  std::normal_distribution<> normal_distribution(100.0);
+
+  for (size_t i = 0; i < n; ++i) {
+    input_data[i] = normal_distribution(gen);
+  }
+}
+
+
+std::string scenario8::name() {
+  std::ostringstream ss;
+  ss << "Sum / variance of X, where X.size = " << input_data.size();
+  return ss.str();
+}
+
+
+int scenario8::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+void scenario8::run_omp() {
+  size_t n = input_data.size();
+  const double* inputs = input_data.data();
+  double sum = 0;
+
+  #pragma omp parallel for reduction(+:sum) num_threads(nthreads)
+  for (size_t i = 0; i < n; ++i) {
+    sum += inputs[i];
+  }
+  result = sum;
+}
+
+
+void scenario8::run_thpool1() {}
+void scenario8::run_thpool2() {}
+
+
+void scenario8::run_thpool3() {
+  const double* inputs = input_data.data();
+  result = dt3::parallel_reduce(
+    /* n = */ input_data.size(),
+    /* nthreads = */ static_cast<size_t>(nthreads),
+    /* init = */ 0.0,
+    [=](size_t i) { return inputs[i]; },
+    [](double a, double b) { return a + b; });
+}
+
+
+std::vector<scenario::variant> scenario8::thpool3_variants() {
+  const double* inputs = input_data.data();
+  size_t n = input_data.size();
+  return {
+    // The sum accumulated directly into a shared atomic.
+    {"atomic", [=] {
+      dt3::atomic<double> sum(0.0);
+      dt3::parallel_for_static(n,
+        [&](size_t i) {
+          sum.fetch_add(inputs[i]);
+        });
+      result = sum.load();
+    }},
+    {"variance", [=] {
+      result = dt3::parallel_moments(n,
+        [=](size_t i) { return inputs[i]; }).variance;
+    }},
+  };
+}
+
+
+std::vector<scenario::variant> scenario8::omp_variants() {
+  const double* inputs = input_data.data();
+  size_t n = input_data.size();
+  return {
+    {"variance", [=] {
+      double shift = n? inputs[0] : 0.0;
+      double sum = 0, sumsq = 0;
+      #pragma omp parallel for reduction(+:sum, sumsq) num_threads(nthreads)
+      for (size_t i = 0; i < n; ++i) {
+        double x = inputs[i] - shift;
+        sum += x;
+        sumsq += x * x;
+      }
+      result = n > 1? (sumsq - sum * sum / n) / (n - 1) : 0.0;
+    }},
+  };
+}
@@ -0,0 +1,123 @@
+#include <numeric>
+#include <random>
+#include <sstream>
+#include "scenario.h"
+
+
+scenario9::scenario9(size_t n, size_t seed, bool integer_)
+  : integer(integer_)
+{
+  std::mt19937 gen{ static_cast<uint32_t>(seed) };
+  if (integer) {
+    int_input.resize(n);
+    int_output.resize(n);
+    std::uniform_int_distribution<int64_t> uniform_distribution(-1000, 1000);
+    for (size_t i = 0; i < n; ++i) {
+      int_input[i] = uniform_distribution(gen);
+    }
+  } else {
+    real_input.resize(n);
+    real_output.resize(n);
+    std::normal_distribution<> normal_distribution(0.0);
+    for (size_t i = 0; i < n; ++i) {
+      real_input[i] = normal_distribution(gen);
+    }
+  }
+}
+
+
+std::string scenario9::name() {
+  std::ostringstream ss;
+  ss << "Prefix sums of " << (integer? "int64" : "double")
+     << " X, where X.size = "
+     << (integer? int_input.size() : real_input.size());
+  return ss.str();
+}
+
+
+int scenario9::available_backends() {
+  return Backend::OMP | Backend::TP3;
+}
+
+
+// The same two-pass scan as `dt3::parallel_inclusive_scan()`, written by
+// hand: OpenMP has no scan construct before version 5.0.
+template <typename T>
+void scenario9::scan_omp(const std::vector<T>& src, std::vector<T>& dst) {
+  size_t n = src.size();
+  const T* x = src.data();
+  T* y = dst.data();
+  std::vector<T> totals(static_cast<size_t>(nthreads));
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    size_t nth = static_cast<size_t>(omp_get_num_threads());
+    size_t ith = static_cast<size_t>(omp_get_thread_num());
+    size_t i0 = n * ith / nth;
+    size_t i1 = n * (ith + 1) / nth;
+    T sum = T(0);
+    for (size_t i = i0; i < i1; ++i) sum += x[i];
+    totals[ith] = sum;
+    #pragma omp barrier
+    T carry = T(0);
+    for (size_t j = 0; j < ith; ++j) carry += totals[j];
+    for (size_t i = i0; i < i1; ++i) {
+      carry += x[i];
+      y[i] = carry;
+    }
+  }
+}
+
+
+void scenario9::run_omp() {
+  if (integer) scan_omp(int_input, int_output);
+  else         scan_omp(real_input, real_output);
+}
+
+
+void scenario9::run_thpool1() {}
+void scenario9::run_thpool2() {}
+
+
+void scenario9::run_thpool3() {
+  size_t nth = static_cast<size_t>(nthreads);
+  if (integer) {
+    dt3::parallel_inclusive_scan(int_input.data(), int_output.data(),
+                                 int_input.size(), nth);
+  } else {
+    dt3::parallel_inclusive_scan(real_input.data(), real_output.data(),
+                                 real_input.size(), nth);
+  }
+}
+
+
+std::vector<scenario::variant> scenario9::thpool3_variants() {
+  size_t nth = static_cast<size_t>(nthreads);
+  return {
+    {"exclusive", [=] {
+      if (integer) {
+        dt3::parallel_exclusive_scan(int_input.data(), int_output.data(),
+                                     int_input.size(), nth, int64_t(0));
+      } else {
+        dt3::parallel_exclusive_scan(real_input.data(), real_output.data(),
+                                     real_input.size(), nth, 0.0);
+      }
+    }},
+  };
+}
+
+
+std::vector<scenario::variant> scenario9::omp_variants() {
+  return {
+    // The serial baseline.
+    {"partial_sum", [=] {
+      if (integer) {
+        std::partial_sum(int_input.begin(), int_input.end(),
+                         int_output.begin());
+      } else {
+        std::partial_sum(real_input.begin(), real_input.end(),
+                         real_output.begin());
+      }
+    }},
+  };
+}
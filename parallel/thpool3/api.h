@@ -16,8 +16,13 @@
 #ifndef dt3_PARALLEL_API_h
 #define dt3_PARALLEL_API_h
 #include <cstddef>
+#include <cstdint>       // int32_t, uint64_t
 #include <functional>    // std::function
+#include <limits>        // std::numeric_limits
+#include <vector>        // std::vector
+#include "thpool3/task_group.h"  // task_group
 #include "utils/function.h"
+#include "utils/macros.h"        // cache_aligned
 namespace dt3 {
 using std::size_t;
 using namespace dt;
@@ -25,6 +30,17 @@ using namespace dt;
 // Private
 void _parallel_for_static(size_t, size_t, size_t,
                           std::function<void(size_t, size_t)>);
+size_t _parallel_compact(size_t, size_t,
+                         function<void(size_t, size_t, uint64_t*)>,
+                         function<void(size_t)>,
+                         function<void(size_t, uint64_t, size_t)>);
+size_t _parallel_reduce(size_t, size_t,
+                        function<void(size_t)>,
+                        function<void(size_t, size_t, size_t)>);
+void _parallel_scan(size_t, size_t,
+                    function<void(size_t)>,
+                    function<void(size_t, size_t, size_t)>,
+                    function<void(size_t, size_t, size_t)>);
 
 
 //------------------------------------------------------------------------------
@@ -84,6 +100,12 @@ size_t get_hardware_concurrency() noexcept;
 
 /**
  * Call function `f` exactly once in each thread.
+ *
+ * Parallel regions may be nested: a region started from within another
+ * region, or from the body of a parallel loop, is executed by the calling
+ * thread together with whichever threads of the pool are idle at the time.
+ * The pool is never oversubscribed, and if no threads are idle the calling
+ * thread executes all of the region by itself.
  */
 void parallel_region(size_t nthreads, function<void()> f);
 void parallel_region(function<void()> f);
@@ -95,6 +117,7 @@ void parallel_region(function<void()> f);
  * Note: it is the user's responsibility to ensure that all threads CAN arrive
  * at the barrier. If not, a deadlock will occur as the threads will be waiting
  * for all the team to arrive before they could proceed.
+ * The barrier is not available within a nested parallel region.
  */
 void barrier();
 
@@ -130,12 +153,418 @@ void parallel_for_static(size_t nrows, size_t chunk_size, size_t nthreads,
 }
 
 
+/**
+ * Scheduling policy for `parallel_for_dynamic()`:
+ *
+ *   stealing()    - work stealing: each thread starts with its own
+ *                   contiguous share of the iterations, and threads that run
+ *                   out of work steal half of the remaining work of other
+ *                   threads. This is the default;
+ *
+ *   chunked(k)    - the threads take `k` consecutive iterations at a time
+ *                   from a shared counter;
+ *
+ *   guided(k)     - same, but each chunk is a fraction of the iterations
+ *                   that remain (and at least `k`), so the chunks shrink as
+ *                   the work runs out. This is similar to OpenMP's
+ *                   `schedule(guided, k)`;
+ *
+ *   adaptive()    - each thread measures how long its chunks take, and sizes
+ *                   its next chunk so that it runs for about 20us, but no
+ *                   longer than a guided chunk would.
+ *
+ * Within a parallel region all schedules use the shared counter, and the
+ * `stealing()` schedule means chunks of 1 iteration.
+ */
+struct dynamic_schedule {
+  enum kind_t { STEALING, CHUNKED, GUIDED, ADAPTIVE };
+  kind_t kind;
+  size_t chunk;
+
+  static dynamic_schedule stealing() { return {STEALING, 1}; }
+  static dynamic_schedule chunked(size_t k) { return {CHUNKED, k}; }
+  static dynamic_schedule guided(size_t k = 1) { return {GUIDED, k}; }
+  static dynamic_schedule adaptive() { return {ADAPTIVE, 1}; }
+};
+
+
 /**
  * Run parallel loop `for i in range(nrows): f(i)`, with dynamic scheduling.
  */
 void parallel_for_dynamic(size_t nrows, std::function<void(size_t)> fn);
 void parallel_for_dynamic(size_t nrows, size_t nthreads,
                           std::function<void(size_t)> fn);
+void parallel_for_dynamic(size_t nrows, size_t nthreads, dynamic_schedule,
+                          std::function<void(size_t)> fn);
+
+
+
+/**
+ * Parallel stable filter: return the indices of all rows `i` in the range
+ * `[0, nrows)` for which `pred(i)` is true, in increasing order. The result
+ * is a row-index vector, which can be used directly as the `o` array of the
+ * sort kernels.
+ *
+ * The rows are split into one contiguous range per thread. Each thread first
+ * evaluates the predicate over its range 64 rows at a time, packing the
+ * results into a bit mask (the loop over a block has no branches, so that
+ * the compiler can vectorize it), and counts the selected rows. After a
+ * prefix sum of the per-thread counts, every thread knows where its part of
+ * the output starts, and writes out the selected rows from the saved masks
+ * (the predicate is evaluated only once per row).
+ */
+template <typename P>
+std::vector<int32_t> parallel_filter(size_t nrows, size_t nthreads, P pred);
+
+template <typename P>
+std::vector<int32_t> parallel_filter(size_t nrows, P pred) {
+  return parallel_filter(nrows, num_threads_available(), pred);
+}
+
+
+/**
+ * Parallel stable compaction: copy the elements of `src[0 .. n)` for which
+ * `pred(src[i])` is true into `dst`, preserving their order, and return the
+ * number of elements copied. The array `dst` should have room for `n`
+ * elements. This is the same algorithm as `parallel_filter()`, except that
+ * the values are written out instead of their indices.
+ */
+template <typename T, typename P>
+size_t parallel_compact(const T* src, size_t n, T* dst, P pred);
+
+
+// Evaluate `pred(i)` for rows `[i0, i1)` and store the results as bit masks
+// of 64 rows each. `i0` must be a multiple of 64, only the last block can be
+// incomplete (its missing rows are 0s in the mask).
+template <typename P>
+inline void _evaluate_masks(size_t i0, size_t i1, uint64_t* masks, P& pred) {
+  for (; i0 + 64 <= i1; i0 += 64) {
+    uint64_t m = 0;
+    for (size_t j = 0; j < 64; ++j) {
+      m |= static_cast<uint64_t>(static_cast<bool>(pred(i0 + j))) << j;
+    }
+    *masks++ = m;
+  }
+  if (i0 < i1) {
+    uint64_t m = 0;
+    for (size_t j = 0; i0 + j < i1; ++j) {
+      m |= static_cast<uint64_t>(static_cast<bool>(pred(i0 + j))) << j;
+    }
+    *masks = m;
+  }
+}
+
+// Compress-store: call `emit(k, i0 + j)` for each bit `j` set in `mask`, with
+// `k` the consecutive output positions starting from `k0`. Full blocks are
+// copied without looking at the individual bits.
+template <typename E>
+inline void _store_selected(size_t i0, uint64_t mask, size_t k0, E& emit) {
+  if (mask == ~uint64_t(0)) {
+    for (size_t j = 0; j < 64; ++j) emit(k0 + j, i0 + j);
+    return;
+  }
+  while (mask) {
+    emit(k0++, i0 + static_cast<size_t>(__builtin_ctzll(mask)));
+    mask &= mask - 1;
+  }
+}
+
+template <typename P>
+std::vector<int32_t> parallel_filter(size_t nrows, size_t nthreads, P pred) {
+  std::vector<int32_t> out;
+  int32_t* rows = nullptr;
+  auto emit = [&](size_t k, size_t i) { rows[k] = static_cast<int32_t>(i); };
+  _parallel_compact(nrows, nthreads,
+    [&](size_t i0, size_t i1, uint64_t* masks) {
+      _evaluate_masks(i0, i1, masks, pred);
+    },
+    [&](size_t nout) {
+      out.resize(nout);
+      rows = out.data();
+    },
+    [&](size_t i0, uint64_t mask, size_t k0) {
+      _store_selected(i0, mask, k0, emit);
+    });
+  return out;
+}
+
+template <typename T, typename P>
+size_t parallel_compact(const T* src, size_t n, T* dst, P pred) {
+  auto test = [&](size_t i) { return pred(src[i]); };
+  auto emit = [&](size_t k, size_t i) { dst[k] = src[i]; };
+  return _parallel_compact(n, num_threads_available(),
+    [&](size_t i0, size_t i1, uint64_t* masks) {
+      _evaluate_masks(i0, i1, masks, test);
+    },
+    [](size_t) {},
+    [&](size_t i0, uint64_t mask, size_t k0) {
+      _store_selected(i0, mask, k0, emit);
+    });
+}
+
+
+
+/**
+ * Parallel reduction: compute
+ *
+ *     combine(...combine(combine(map(0), map(1)), map(2))..., map(n - 1))
+ *
+ * where `combine` is associative (but not necessarily commutative), and
+ * `init` is its identity element (0 for a sum, 1 for a product, etc). The
+ * result is `init` when `n` is 0. The accumulator type `T` may be any
+ * copyable type, for example a struct of several accumulators that are
+ * reduced at once (see `parallel_moments()` below).
+ *
+ * The rows are split into one contiguous range per thread, and each thread
+ * reduces its range into a local accumulator, starting from `init`; both
+ * `map` and `combine` are inlined into this loop. The per-thread partial
+ * results are stored in cache-line-padded slots, and then combined pairwise
+ * in a tree. For a given number of threads the order of the operations is
+ * fixed, so the result is reproducible even for floating-point types.
+ *
+ * The reduction may be called from anywhere, including the body of a
+ * parallel loop, where it runs as a nested region.
+ */
+template <typename T, typename M, typename C>
+T parallel_reduce(size_t n, size_t nthreads, T init, M map, C combine);
+
+template <typename T, typename M, typename C>
+T parallel_reduce(size_t n, T init, M map, C combine) {
+  return parallel_reduce(n, num_threads_in_pool(), init, map, combine);
+}
+
+
+// Identity elements for `parallel_min()` / `parallel_max()`.
+template <typename T>
+inline T _highest_value() {
+  return std::numeric_limits<T>::has_infinity
+           ? std::numeric_limits<T>::infinity()
+           : std::numeric_limits<T>::max();
+}
+
+template <typename T>
+inline T _lowest_value() {
+  return std::numeric_limits<T>::has_infinity
+           ? -std::numeric_limits<T>::infinity()
+           : std::numeric_limits<T>::lowest();
+}
+
+
+/**
+ * Common reductions of `f(i)` over the rows `[0, n)`. The type of the
+ * result is the type returned by `f`, except for `parallel_count()` which
+ * counts the rows for which `f(i)` is true. The min / max of 0 rows are the
+ * largest / smallest values of the type (infinities, for floating-point
+ * types).
+ */
+template <typename F>
+auto parallel_sum(size_t n, F f) -> decltype(f(size_t(0))) {
+  using T = decltype(f(size_t(0)));
+  return parallel_reduce(n, T(0), f,
+                         [](T a, T b) { return a + b; });
+}
+
+template <typename F>
+auto parallel_min(size_t n, F f) -> decltype(f(size_t(0))) {
+  using T = decltype(f(size_t(0)));
+  return parallel_reduce(n, _highest_value<T>(), f,
+                         [](T a, T b) { return b < a? b : a; });
+}
+
+template <typename F>
+auto parallel_max(size_t n, F f) -> decltype(f(size_t(0))) {
+  using T = decltype(f(size_t(0)));
+  return parallel_reduce(n, _lowest_value<T>(), f,
+                         [](T a, T b) { return a < b? b : a; });
+}
+
+template <typename F>
+size_t parallel_count(size_t n, F f) {
+  return parallel_reduce(n, size_t(0),
+                         [&](size_t i) { return size_t(bool(f(i))); },
+                         [](size_t a, size_t b) { return a + b; });
+}
+
+
+/**
+ * Count, mean and (sample) variance of `f(i)` over the rows `[0, n)`.
+ *
+ * This is an example of a reduction with a struct accumulator: the sums of
+ * the values and of their squares are accumulated together, as
+ * `_moments_acc`. The values are shifted by `f(0)` first, which avoids the
+ * catastrophic cancellation of the naive sum-of-squares formula when the
+ * mean is large compared to the standard deviation.
+ */
+struct moments {
+  size_t count;
+  double mean;
+  double variance;
+};
+
+struct _moments_acc {
+  double n, sum, sumsq;
+};
+
+template <typename F>
+moments parallel_moments(size_t n, F f) {
+  if (n == 0) return {0, 0.0, 0.0};
+  double shift = static_cast<double>(f(size_t(0)));
+  _moments_acc acc = parallel_reduce(n, _moments_acc {0, 0, 0},
+    [&](size_t i) {
+      double x = static_cast<double>(f(i)) - shift;
+      return _moments_acc {1.0, x, x * x};
+    },
+    [](const _moments_acc& a, const _moments_acc& b) {
+      return _moments_acc {a.n + b.n, a.sum + b.sum, a.sumsq + b.sumsq};
+    });
+  double mean = acc.sum / acc.n;
+  double var = n > 1? (acc.sumsq - acc.sum * mean) / (acc.n - 1) : 0.0;
+  return {n, shift + mean, var};
+}
+
+
+template <typename T, typename M, typename C>
+T parallel_reduce(size_t n, size_t nthreads, T init, M map, C combine) {
+  std::vector<cache_aligned<T>> partials;
+  size_t nparts = _parallel_reduce(n, nthreads,
+    [&](size_t k) {
+      partials.assign(k, cache_aligned<T>(init));
+    },
+    [&](size_t k, size_t i0, size_t i1) {
+      T acc = init;
+      for (size_t i = i0; i < i1; ++i) {
+        acc = combine(acc, map(i));
+      }
+      partials[k].v = acc;
+    });
+  if (nparts == 0) return init;
+  for (size_t step = 1; step < nparts; step *= 2) {
+    for (size_t k = 0; k + step < nparts; k += 2 * step) {
+      partials[k].v = combine(partials[k].v, partials[k + step].v);
+    }
+  }
+  return partials[0].v;
+}
+
+
+
+/**
+ * Parallel prefix sums of `src[0 .. n)`, written into `dst` (which may be
+ * the same array as `src`):
+ *
+ *     inclusive:  dst[i] = src[0] + src[1] + ... + src[i]
+ *     exclusive:  dst[i] = init + src[0] + ... + src[i - 1]
+ *
+ * The rows are split into one contiguous range per thread, and the scan
+ * makes two passes over them: first each thread computes the total of its
+ * range; then, once all totals are known, each thread scans its range
+ * starting from the sum of the totals of the preceding ranges. Arrays that
+ * are too small to be worth the second read of `src` are scanned serially.
+ *
+ * Within a range the elements are added SCAN_WIDTH at a time (see
+ * `_scan_block()`), which lets the compiler vectorize the scan. For
+ * floating-point types the result may therefore differ from a sequential
+ * `std::partial_sum()` in the last bits; for integer types it is identical.
+ *
+ * When called from within a parallel region, the scan runs in the calling
+ * thread only.
+ */
+template <typename T>
+void parallel_inclusive_scan(const T* src, T* dst, size_t n,
+                             size_t nthreads);
+
+template <typename T>
+void parallel_inclusive_scan(const T* src, T* dst, size_t n) {
+  parallel_inclusive_scan(src, dst, n, num_threads_in_pool());
+}
+
+template <typename T>
+void parallel_exclusive_scan(const T* src, T* dst, size_t n,
+                             size_t nthreads, T init);
+
+template <typename T>
+void parallel_exclusive_scan(const T* src, T* dst, size_t n, T init = T(0)) {
+  parallel_exclusive_scan(src, dst, n, num_threads_in_pool(), init);
+}
+
+
+// Number of elements scanned at a time by `_scan_block()`, and number of
+// accumulators in `_sum_block()`.
+static constexpr size_t SCAN_WIDTH = 8;
+
+// Sum of `x[0 .. n)`, with SCAN_WIDTH independent accumulators (so that the
+// loop can be vectorized).
+template <typename T>
+inline T _sum_block(const T* x, size_t n) {
+  T acc[SCAN_WIDTH] = {};
+  size_t i = 0;
+  for (; i + SCAN_WIDTH <= n; i += SCAN_WIDTH) {
+    for (size_t k = 0; k < SCAN_WIDTH; ++k) acc[k] += x[i + k];
+  }
+  T total = T(0);
+  for (size_t k = 0; k < SCAN_WIDTH; ++k) total += acc[k];
+  for (; i < n; ++i) total += x[i];
+  return total;
+}
+
+// Scan of `x[0 .. n)` into `y`, starting from `carry`. In a sequential scan
+// every addition depends on the previous one. Here the elements are taken
+// SCAN_WIDTH at a time: the prefix sums within the group do not depend on
+// the carry, and are then added to it all at once (a vector addition), so
+// the chain of dependent additions is SCAN_WIDTH times shorter.
+template <bool INCLUSIVE, typename T>
+inline void _scan_block(const T* x, T* y, size_t n, T carry) {
+  constexpr size_t W = SCAN_WIDTH;
+  size_t i = 0;
+  for (; i + W <= n; i += W) {
+    T p[W];
+    p[0] = x[i];
+    for (size_t k = 1; k < W; ++k) p[k] = p[k - 1] + x[i + k];
+    if (INCLUSIVE) {
+      for (size_t k = 0; k < W; ++k) y[i + k] = carry + p[k];
+    } else {
+      y[i] = carry;
+      for (size_t k = 1; k < W; ++k) y[i + k] = carry + p[k - 1];
+    }
+    carry += p[W - 1];
+  }
+  for (; i < n; ++i) {
+    T v = x[i];
+    if (!INCLUSIVE) y[i] = carry;
+    carry += v;
+    if (INCLUSIVE) y[i] = carry;
+  }
+}
+
+template <bool INCLUSIVE, typename T>
+void _parallel_scan_impl(const T* src, T* dst, size_t n, size_t nthreads,
+                         T init) {
+  std::vector<cache_aligned<T>> totals;
+  _parallel_scan(n, nthreads,
+    [&](size_t k) {
+      totals.assign(k, cache_aligned<T>(T(0)));
+    },
+    [&](size_t k, size_t i0, size_t i1) {
+      totals[k].v = _sum_block(src + i0, i1 - i0);
+    },
+    [&](size_t k, size_t i0, size_t i1) {
+      T carry = init;
+      for (size_t j = 0; j < k; ++j) carry += totals[j].v;
+      _scan_block<INCLUSIVE>(src + i0, dst + i0, i1 - i0, carry);
+    });
+}
+
+template <typename T>
+void parallel_inclusive_scan(const T* src, T* dst, size_t n,
+                             size_t nthreads) {
+  _parallel_scan_impl<true>(src, dst, n, nthreads, T(0));
+}
+
+template <typename T>
+void parallel_exclusive_scan(const T* src, T* dst, size_t n,
+                             size_t nthreads, T init) {
+  _parallel_scan_impl<false>(src, dst, n, nthreads, init);
+}
 
 
 
@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+#include <algorithm>  // std::min
+#include <vector>     // std::vector
+#include "thpool3/api.h"
+#include "thpool3/thread_pool.h"
+#include "utils/assert.h"
+#include "utils/function.h"
+#include "utils/macros.h"          // cache_aligned
+namespace dt3 {
+
+// Each thread should get at least this many blocks of 64 rows, otherwise
+// the filter uses fewer threads.
+static constexpr size_t MIN_BLOCKS_PER_THREAD = 64;
+
+
+static size_t count_selected(const uint64_t* masks, size_t nblocks) {
+  size_t count = 0;
+  for (size_t b = 0; b < nblocks; ++b) {
+    count += static_cast<size_t>(__builtin_popcountll(masks[b]));
+  }
+  return count;
+}
+
+static void store_blocks(const uint64_t* masks, size_t b0, size_t b1,
+                         size_t k, function<void(size_t, uint64_t, size_t)> store)
+{
+  for (size_t b = b0; b < b1; ++b) {
+    uint64_t m = masks[b];
+    if (!m) continue;
+    store(b * 64, m, k);
+    k += static_cast<size_t>(__builtin_popcountll(m));
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// parallel_compact
+//------------------------------------------------------------------------------
+
+// Implementation of `parallel_filter()` and `parallel_compact()`:
+//   - `evaluate(i0, i1, masks)` computes the masks of rows [i0, i1);
+//   - `allocate(nout)` is called once, by a single thread, when the total
+//     number of selected rows is known and before any of them is stored;
+//   - `store(i0, mask, k)` writes out the rows selected by `mask` within the
+//     block that starts at row `i0`, at the output position `k`.
+// Returns the number of selected rows.
+//
+// When called from within a parallel region, the filter runs in the calling
+// thread only.
+size_t _parallel_compact(size_t nrows, size_t nthreads,
+                         function<void(size_t, size_t, uint64_t*)> evaluate,
+                         function<void(size_t)> allocate,
+                         function<void(size_t, uint64_t, size_t)> store)
+{
+  size_t nblocks = (nrows + 63) / 64;
+  std::vector<uint64_t> masks(nblocks);
+  if (nthreads == 0) nthreads = num_threads_in_pool();
+  size_t nth = std::min(std::min(nthreads, thpool->size()),
+                        nblocks / MIN_BLOCKS_PER_THREAD);
+
+  if (nth <= 1 || thpool->in_parallel_region()) {
+    evaluate(0, nrows, masks.data());
+    size_t total = count_selected(masks.data(), nblocks);
+    allocate(total);
+    store_blocks(masks.data(), 0, nblocks, 0, store);
+    return total;
+  }
+
+  std::vector<cache_aligned<size_t>> counts(nth, 0);
+  size_t total = 0;
+  parallel_region(nth,
+    [&] {
+      size_t ith = this_thread_index();
+      size_t b0 = nblocks * ith / nth;
+      size_t b1 = nblocks * (ith + 1) / nth;
+      evaluate(b0 * 64, std::min(b1 * 64, nrows), masks.data() + b0);
+      counts[ith].v = count_selected(masks.data() + b0, b1 - b0);
+      barrier();
+
+      size_t k = 0;
+      for (size_t i = 0; i < ith; ++i) k += counts[i].v;
+      if (ith == nth - 1) {
+        total = k + counts[ith].v;
+        allocate(total);
+      }
+      barrier();
+
+      store_blocks(masks.data(), b0, b1, k, store);
+    });
+  return total;
+}
+
+
+
+}  // namespace dt
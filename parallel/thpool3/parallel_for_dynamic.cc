@@ -13,7 +13,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //------------------------------------------------------------------------------
+#include <algorithm>  // std::min, std::max
 #include <atomic>     // std::atomic
+#include <chrono>     // std::chrono::steady_clock
+#include <cstdint>    // int64_t, uint64_t
+#include <thread>     // std::this_thread::yield
 #include <vector>     // std::vector
 #include "thpool3/api.h"
 #include "thpool3/thread_pool.h"
@@ -29,25 +33,37 @@ namespace dt3 {
 // dynamic_task
 //------------------------------------------------------------------------------
 using dynamicfn_t = std::function<void(size_t)>;
+using steady_clock = std::chrono::steady_clock;
+
+// With the adaptive schedule, chunks are sized to take about this long
+// (in nanoseconds).
+static constexpr double ADAPTIVE_CHUNK_NS = 20000.0;
 
 struct alignas(CACHELINE_SIZE) dynamic_task : public thread_task {
+  friend class dynamic_scheduler;
   private:
-    size_t iter;
+    size_t iter0;
+    size_t iter1;
     dynamicfn_t fn;
+    // Used by the adaptive schedule: when the current chunk was handed out
+    steady_clock::time_point chunk_start;
     // PAD_TO_CACHELINE(sizeof(fn) + sizeof(iter) + sizeof(thread_task));
 
   public:
-    dynamic_task() = default;
+    dynamic_task();
     dynamic_task(const dynamicfn_t& f);
     dynamic_task(const dynamic_task&);
     dynamic_task& operator=(const dynamic_task&);
 
-    void set_iter(size_t i) noexcept;
+    void set_range(size_t i0, size_t i1) noexcept;
     void execute(thread_worker*) override;
 };
 
+dynamic_task::dynamic_task()
+  : iter0(0), iter1(0) {}
+
 dynamic_task::dynamic_task(const dynamicfn_t& f)
-  : iter(size_t(-1)), fn(f) {}
+  : iter0(0), iter1(0), fn(f) {}
 
 dynamic_task::dynamic_task(const dynamic_task& other) {
   fn = other.fn;
@@ -59,12 +75,14 @@ dynamic_task& dynamic_task::operator=(const dynamic_task& other) {
 }
 
 
-void dynamic_task::set_iter(size_t i) noexcept {
-  iter = i;
+void dynamic_task::set_range(size_t i0, size_t i1) noexcept {
+  iter0 = i0;
+  iter1 = i1;
 }
 
 void dynamic_task::execute(thread_worker*) {
-  fn(iter);
+  team_scope scope(nullptr);
+  for (size_t i = iter0; i < iter1; ++i) fn(i);
 }
 
 
@@ -74,27 +92,46 @@ void dynamic_task::execute(thread_worker*) {
 // dynamic_scheduler
 //------------------------------------------------------------------------------
 
+/**
+ * Scheduler where all threads take chunks of consecutive iterations from a
+ * single shared counter. The size of the chunks is given by the schedule
+ * (see `dynamic_schedule` in "api.h"); the work-stealing schedule is not
+ * handled by this class, and here means chunks of 1 iteration.
+ */
 class dynamic_scheduler : public thread_scheduler {
   private:
     std::vector<dynamic_task> tasks;
     size_t nthreads;
     size_t num_iterations;
+    dynamic_schedule schedule;
     std::atomic<size_t> iteration_index;
 
   public:
-    dynamic_scheduler(size_t nthreads, size_t niters);
+    dynamic_scheduler(size_t nthreads, size_t niters, dynamic_schedule);
     void set_task(const dynamicfn_t&);
     void set_task(const dynamicfn_t&, size_t i);
     thread_task* get_next_task(size_t thread_index) override;
     void abort_execution() override;
+
+  private:
+    size_t guided_chunk_size() const noexcept;
+    size_t adaptive_chunk_size(dynamic_task*) const noexcept;
 };
 
 
-dynamic_scheduler::dynamic_scheduler(size_t nthreads_, size_t niters)
+dynamic_scheduler::dynamic_scheduler(size_t nthreads_, size_t niters,
+                                     dynamic_schedule sch)
   : tasks(nthreads_),
     nthreads(nthreads_),
     num_iterations(niters),
-    iteration_index(0) {}
+    schedule(sch),
+    iteration_index(0)
+{
+  if (schedule.kind == dynamic_schedule::STEALING) {
+    schedule = dynamic_schedule::chunked(1);
+  }
+  if (schedule.chunk == 0) schedule.chunk = 1;
+}
 
 
 void dynamic_scheduler::set_task(const dynamicfn_t& f) {
@@ -107,14 +144,51 @@ void dynamic_scheduler::set_task(const dynamicfn_t& f, size_t i) {
 }
 
 
+// A fraction of the remaining iterations, so that every thread gets a few
+// more chunks before the work runs out, but at least `schedule.chunk`.
+size_t dynamic_scheduler::guided_chunk_size() const noexcept {
+  size_t next = iteration_index.load(std::memory_order_relaxed);
+  size_t remaining = next < num_iterations? num_iterations - next : 0;
+  return std::max(remaining / (2 * nthreads), schedule.chunk);
+}
+
+
+// Size the next chunk so that it would take about ADAPTIVE_CHUNK_NS, given
+// how long the previous chunk of this thread took. The chunk can grow at
+// most 4x at a time (the timing of tiny chunks is noisy), and is never
+// larger than a guided chunk.
+size_t dynamic_scheduler::adaptive_chunk_size(dynamic_task* task)
+  const noexcept
+{
+  size_t prev = task->iter1 - task->iter0;
+  size_t size = schedule.chunk;
+  if (prev) {
+    std::chrono::duration<double, std::nano> elapsed =
+        steady_clock::now() - task->chunk_start;
+    double ns_per_iter = std::max(elapsed.count(), 1.0) / prev;
+    size = static_cast<size_t>(ADAPTIVE_CHUNK_NS / ns_per_iter);
+    size = std::min(std::max(size, size_t(1)), 4 * prev);
+    size = std::min(size, guided_chunk_size());
+  }
+  return size;
+}
+
+
 thread_task* dynamic_scheduler::get_next_task(size_t thread_index) {
   if (thread_index >= nthreads) return nullptr;
-  size_t next_iter = iteration_index.fetch_add(1);
+  dynamic_task* ptask = &tasks[thread_index];
+  size_t size = schedule.kind == dynamic_schedule::GUIDED
+                  ? guided_chunk_size() :
+                schedule.kind == dynamic_schedule::ADAPTIVE
+                  ? adaptive_chunk_size(ptask) : schedule.chunk;
+  size_t next_iter = iteration_index.fetch_add(size);
   if (next_iter >= num_iterations) {
     return nullptr;
   }
-  dynamic_task* ptask = &tasks[thread_index];
-  ptask->set_iter(next_iter);
+  ptask->set_range(next_iter, std::min(next_iter + size, num_iterations));
+  if (schedule.kind == dynamic_schedule::ADAPTIVE) {
+    ptask->chunk_start = steady_clock::now();
+  }
   return ptask;
 }
 
@@ -127,36 +201,281 @@ void dynamic_scheduler::abort_execution() {
 
 
 
+//------------------------------------------------------------------------------
+// range_deque
+//------------------------------------------------------------------------------
+
+/**
+ * Chase-Lev work-stealing deque of iteration ranges `[i0, i1)`, with a fixed
+ * capacity. The owner thread pushes and pops ranges at the bottom, while
+ * other threads steal them from the top. A range is read before the `top`
+ * index is claimed with a CAS, and a slot is never reused until `top` moves
+ * past it, so a thief whose CAS succeeds has read a valid range.
+ *
+ * The owner pushes a range only when its deque is empty (see
+ * `stealing_scheduler::run()`), so the capacity is never approached.
+ */
+class range_deque {
+  private:
+    static constexpr int64_t CAPACITY = 64;
+    struct slot {
+      std::atomic<size_t> i0;
+      std::atomic<size_t> i1;
+    };
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    slot slots[CAPACITY];
+
+  public:
+    range_deque();
+    bool empty() const noexcept;
+    void push(size_t i0, size_t i1) noexcept;
+    bool pop(size_t* i0, size_t* i1) noexcept;
+    bool steal(size_t* i0, size_t* i1) noexcept;
+
+  private:
+    void read(int64_t i, size_t* i0, size_t* i1) const noexcept;
+};
+
+
+range_deque::range_deque() : top(0), bottom(0) {}
+
+bool range_deque::empty() const noexcept {
+  return bottom.load(std::memory_order_relaxed) <=
+         top.load(std::memory_order_relaxed);
+}
+
+void range_deque::read(int64_t i, size_t* i0, size_t* i1) const noexcept {
+  const slot& s = slots[i % CAPACITY];
+  *i0 = s.i0.load(std::memory_order_relaxed);
+  *i1 = s.i1.load(std::memory_order_relaxed);
+}
+
+void range_deque::push(size_t i0, size_t i1) noexcept {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  xassert(b - top.load(std::memory_order_relaxed) < CAPACITY);
+  slot& s = slots[b % CAPACITY];
+  s.i0.store(i0, std::memory_order_relaxed);
+  s.i1.store(i1, std::memory_order_relaxed);
+  bottom.store(b + 1, std::memory_order_release);
+}
+
+bool range_deque::pop(size_t* i0, size_t* i1) noexcept {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b);  // seq_cst: must be visible before `top` is read
+  int64_t t = top.load();
+  if (t > b) {
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+  read(b, i0, i1);
+  if (t < b) return true;
+  // Last range in the deque: race against the thieves for it
+  bool won = top.compare_exchange_strong(t, t + 1);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return won;
+}
+
+bool range_deque::steal(size_t* i0, size_t* i1) noexcept {
+  int64_t t = top.load();
+  int64_t b = bottom.load();
+  if (t >= b) return false;
+  read(t, i0, i1);
+  return top.compare_exchange_strong(t, t + 1);
+}
+
+
+
+
+//------------------------------------------------------------------------------
+// stealing_scheduler
+//------------------------------------------------------------------------------
+
+/**
+ * Work-stealing scheduler for `parallel_for_dynamic()`. Every thread starts
+ * with its own contiguous share of the iterations, and executes it `grain`
+ * iterations at a time. The range is split lazily: only when the thread's
+ * deque is empty does it push the upper half of its remaining range there,
+ * making it available to other threads. A thread that runs out of work pops
+ * its deque, and then steals from the deques of random victims; stealing
+ * takes the range that the victim pushed, i.e. half of its work.
+ *
+ * Thus there is no shared state touched per iteration: the threads only
+ * communicate when work actually needs to be redistributed. Each thread adds
+ * the number of iterations it executed to `n_done` before it goes looking
+ * for work elsewhere, and the loop is finished once `n_done` reaches the
+ * total number of iterations.
+ */
+class stealing_scheduler : public thread_scheduler {
+  private:
+    struct alignas(CACHELINE_SIZE) stealing_task : public thread_task {
+      stealing_scheduler* sch;
+      size_t thread_index;
+      bool started;
+      range_deque deque;
+
+      void execute(thread_worker*) override;
+    };
+
+    std::vector<stealing_task> tasks;
+    dynamicfn_t fn;
+    size_t nthreads;
+    size_t num_iterations;
+    size_t grain;
+    std::atomic<size_t> n_done;
+    std::atomic<bool> aborted;
+
+  public:
+    stealing_scheduler(size_t nthreads, size_t niters, const dynamicfn_t&);
+    thread_task* get_next_task(size_t thread_index) override;
+    void abort_execution() override;
+
+  private:
+    void run(size_t thread_index);
+    bool steal(size_t thread_index, uint64_t* rng, size_t* i0, size_t* i1);
+};
+
+
+stealing_scheduler::stealing_scheduler(size_t nthreads_, size_t niters,
+                                       const dynamicfn_t& f)
+  : tasks(nthreads_),
+    fn(f),
+    nthreads(nthreads_),
+    num_iterations(niters),
+    grain(std::max(niters / (nthreads_ * 256), size_t(1))),
+    n_done(0),
+    aborted(false)
+{
+  for (size_t i = 0; i < nthreads; ++i) {
+    tasks[i].sch = this;
+    tasks[i].thread_index = i;
+    tasks[i].started = false;
+  }
+}
+
+
+thread_task* stealing_scheduler::get_next_task(size_t thread_index) {
+  if (thread_index >= nthreads) return nullptr;
+  stealing_task* ptask = &tasks[thread_index];
+  if (ptask->started) return nullptr;
+  ptask->started = true;
+  return ptask;
+}
+
+
+void stealing_scheduler::abort_execution() {
+  aborted.store(true);
+}
+
+
+void stealing_scheduler::stealing_task::execute(thread_worker*) {
+  sch->run(thread_index);
+}
+
+
+void stealing_scheduler::run(size_t ith) {
+  range_deque& deque = tasks[ith].deque;
+  size_t i0 = num_iterations * ith / nthreads;
+  size_t i1 = num_iterations * (ith + 1) / nthreads;
+  uint64_t rng = ith * 0x9E3779B97F4A7C15ULL + 1;
+  size_t executed = 0;
+  while (true) {
+    while (i0 < i1) {
+      if (aborted.load(std::memory_order_relaxed)) return;
+      if (i1 - i0 > 2 * grain && deque.empty()) {
+        size_t mid = i0 + (i1 - i0) / 2;
+        deque.push(mid, i1);
+        i1 = mid;
+      }
+      size_t iend = std::min(i0 + grain, i1);
+      executed += iend - i0;
+      for (; i0 < iend; ++i0) fn(i0);
+    }
+    if (deque.pop(&i0, &i1)) continue;
+    n_done.fetch_add(executed);
+    executed = 0;
+    if (!steal(ith, &rng, &i0, &i1)) return;
+  }
+}
+
+
+// Keep trying to steal a range from other threads until either it succeeds
+// (returns true), or all iterations are done (returns false).
+bool stealing_scheduler::steal(size_t ith, uint64_t* rng,
+                               size_t* i0, size_t* i1)
+{
+  while (true) {
+    if (n_done.load() >= num_iterations) return false;
+    if (aborted.load(std::memory_order_relaxed)) return false;
+    for (size_t k = 1; k < nthreads; ++k) {
+      // xorshift64
+      uint64_t x = *rng;
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      *rng = x;
+      size_t victim = (ith + 1 + x % (nthreads - 1)) % nthreads;
+      if (tasks[victim].deque.steal(i0, i1)) return true;
+    }
+    std::this_thread::yield();
+  }
+}
+
+
+
+
 //------------------------------------------------------------------------------
 // parallel_for_dynamic
 //------------------------------------------------------------------------------
 
-void parallel_for_dynamic(size_t nrows, size_t nthreads, dynamicfn_t fn) {
+void parallel_for_dynamic(size_t nrows, size_t nthreads,
+                          dynamic_schedule schedule, dynamicfn_t fn)
+{
   size_t ith = this_thread_index();
-
+  thread_team* tt = thread_pool::get_team_unchecked();
+
+  // Called from a loop body while the pool is busy: start a nested region,
+  // and share the iterations among its threads
+  if (!tt && thpool->in_parallel_region()) {
+    parallel_region(nthreads,
+      [=] {
+        parallel_for_dynamic(nrows, num_threads_in_team(), schedule, fn);
+      });
+  }
   // Running from the master thread
-  if (!thpool->in_parallel_region()) {
+  else if (!tt) {
     size_t tp_size = thpool->size();
     if (nthreads == 0) nthreads = tp_size;
     size_t tt_size = std::min(nthreads, tp_size);
     thread_team tt(tt_size, thpool);
-    dynamic_scheduler sch(tt_size, nrows);
-    sch.set_task(fn);
-
-    thpool->execute_job(&sch);
+    if (schedule.kind == dynamic_schedule::STEALING) {
+      stealing_scheduler sch(tt_size, nrows, fn);
+      thpool->execute_job(&sch);
+    } else {
+      dynamic_scheduler sch(tt_size, nrows, schedule);
+      sch.set_task(fn);
+      thpool->execute_job(&sch);
+    }
   }
-  // Running inside a parallel region
+  // Running inside a parallel region: all threads of the team share a
+  // single counter of iterations
   else {
-    thread_team* tt = thread_pool::get_team_unchecked();
     // Cannot change number of threads when in a parallel region
     xassert(nthreads == tt->size());
-    auto sch = tt->shared_scheduler<dynamic_scheduler>(nthreads, nrows);
+    auto sch = tt->shared_scheduler<dynamic_scheduler>(nthreads, nrows,
+                                                       schedule);
     sch->set_task(fn, ith);
     sch->execute_in_current_thread();
   }
 }
 
 
+void parallel_for_dynamic(size_t nrows, size_t nthreads, dynamicfn_t fn) {
+  parallel_for_dynamic(nrows, nthreads, dynamic_schedule::stealing(), fn);
+}
+
+
 void parallel_for_dynamic(size_t nrows, dynamicfn_t fn) {
   parallel_for_dynamic(nrows, num_threads_available(), fn);
 }
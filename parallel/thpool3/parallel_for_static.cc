@@ -15,6 +15,7 @@
 //------------------------------------------------------------------------------
 #include "thpool3/api.h"
 #include "thpool3/thread_pool.h"
+#include "thpool3/thread_team.h"
 #include "utils/assert.h"
 #include "utils/function.h"
 namespace dt3 {
@@ -32,8 +33,8 @@ void _parallel_for_static(size_t nrows, size_t min_chunk_size,
   size_t k = std::min(nrows / min_chunk_size, nthreads);
   size_t ith = this_thread_index();
 
-  // Standard parallel loop
-  if (!thpool->in_parallel_region()) {
+  // Standard parallel loop (a nested region, if the pool is busy)
+  if (!thread_pool::get_team_unchecked()) {
     if (k == 0) {
       fn(0, nrows);
     }
@@ -45,6 +46,7 @@ void _parallel_for_static(size_t nrows, size_t min_chunk_size,
       parallel_region(nth,
         [=] {
           size_t ithread = this_thread_index();
+          team_scope scope(nullptr);
           for (size_t j = ithread; j < nchunks; j += nth) {
             size_t i0 = j * chunksize;
             size_t i1 = i0 + chunksize;
@@ -57,6 +59,7 @@ void _parallel_for_static(size_t nrows, size_t min_chunk_size,
   // Parallel loop within a parallel region
   else {
     if (k == 0) {
+      team_scope scope(nullptr);
       if (ith == 0) fn(0, nrows);
     }
     else {
@@ -66,6 +69,7 @@ void _parallel_for_static(size_t nrows, size_t min_chunk_size,
       size_t chunksize = nrows / k;
       size_t nchunks = nrows / chunksize;
 
+      team_scope scope(nullptr);
       for (size_t j = ith; j < nchunks; j += nth) {
         size_t i0 = j * chunksize;
         size_t i1 = i0 + chunksize;
@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+#include <algorithm>  // std::min
+#include "thpool3/api.h"
+#include "thpool3/thread_pool.h"
+#include "utils/function.h"
+namespace dt3 {
+
+// Each thread should get at least this many rows, otherwise the reduction
+// uses fewer threads.
+static constexpr size_t MIN_ROWS_PER_THREAD = 4096;
+
+
+
+//------------------------------------------------------------------------------
+// parallel_reduce
+//------------------------------------------------------------------------------
+
+// Implementation of `parallel_reduce()`:
+//   - `allocate(nparts)` is called once, before any of the rows is reduced,
+//     with the number of partial results that will be produced;
+//   - `reduce(k, i0, i1)` reduces the rows [i0, i1) into the partial result
+//     number `k`.
+// Returns the number of partial results, which is 0 if there are no rows.
+size_t _parallel_reduce(size_t nrows, size_t nthreads,
+                        function<void(size_t)> allocate,
+                        function<void(size_t, size_t, size_t)> reduce)
+{
+  if (nrows == 0) return 0;
+  if (nthreads == 0) nthreads = num_threads_in_pool();
+  size_t nth = std::min(std::min(nthreads, thpool->size()),
+                        nrows / MIN_ROWS_PER_THREAD);
+
+  if (nth <= 1) {
+    allocate(1);
+    reduce(0, 0, nrows);
+    return 1;
+  }
+
+  allocate(nth);
+  parallel_region(nth,
+    [&] {
+      size_t ith = this_thread_index();
+      reduce(ith, nrows * ith / nth, nrows * (ith + 1) / nth);
+    });
+  return nth;
+}
+
+
+
+}  // namespace dt
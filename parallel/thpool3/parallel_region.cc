@@ -30,15 +30,18 @@ namespace dt3 {
 class simple_task : public thread_task {
   private:
     dt::function<void()> f;
+    thread_team* team;
   public:
-    simple_task(dt::function<void()>);
+    simple_task(dt::function<void()>, thread_team*);
     void execute(thread_worker*) override;
 };
 
 
-simple_task::simple_task(dt::function<void()> f_) : f(f_) {}
+simple_task::simple_task(dt::function<void()> f_, thread_team* tt)
+  : f(f_), team(tt) {}
 
 void simple_task::execute(thread_worker*) {
+  team_scope scope(team);
   f();
 }
 
@@ -82,13 +85,20 @@ void parallel_region(dt::function<void()> fn) {
   parallel_region(0, fn);
 }
 
+// A region started while the pool is busy (from within another region, or
+// from the body of a parallel loop) becomes a nested job: its tasks are run
+// by the calling thread and by whichever workers of the pool are idle.
 void parallel_region(size_t nthreads, dt::function<void()> fn) {
-  xassert(!thpool->in_parallel_region());
   size_t nthreads0 = thpool->size();
   if (nthreads > nthreads0 || nthreads == 0) nthreads = nthreads0;
+  if (thpool->in_parallel_region()) {
+    nested_job job(nthreads, fn);
+    thpool->execute_nested(&job);
+    return;
+  }
   thread_team tt(nthreads, thpool);
 
-  simple_task task(fn);
+  simple_task task(fn, &tt);
   once_scheduler sch(nthreads, &task);
   thpool->execute_job(&sch);
 }
@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+#include <algorithm>  // std::min
+#include "thpool3/api.h"
+#include "thpool3/thread_pool.h"
+#include "utils/function.h"
+namespace dt3 {
+
+// Each thread should get at least this many rows, otherwise the scan uses
+// fewer threads (and below twice this many rows, runs serially).
+static constexpr size_t MIN_ROWS_PER_THREAD = 32768;
+
+
+
+//------------------------------------------------------------------------------
+// parallel_scan
+//------------------------------------------------------------------------------
+
+// Implementation of `parallel_inclusive_scan()` and
+// `parallel_exclusive_scan()`:
+//   - `allocate(nparts)` is called once, before the first pass, with the
+//     number of ranges the rows are split into;
+//   - `reduce(k, i0, i1)` computes the total of the range number `k`, which
+//     covers the rows [i0, i1);
+//   - `scan(k, i0, i1)` scans the range number `k`, after the totals of all
+//     ranges before it are known. In the serial case this is called once,
+//     with `k = 0`, and `reduce` is not called at all.
+void _parallel_scan(size_t nrows, size_t nthreads,
+                    function<void(size_t)> allocate,
+                    function<void(size_t, size_t, size_t)> reduce,
+                    function<void(size_t, size_t, size_t)> scan)
+{
+  if (nthreads == 0) nthreads = num_threads_in_pool();
+  size_t nth = std::min(std::min(nthreads, thpool->size()),
+                        nrows / MIN_ROWS_PER_THREAD);
+
+  if (nth <= 1 || thpool->in_parallel_region()) {
+    scan(0, 0, nrows);
+    return;
+  }
+
+  allocate(nth);
+  parallel_region(nth,
+    [&] {
+      size_t ith = this_thread_index();
+      size_t i0 = nrows * ith / nth;
+      size_t i1 = nrows * (ith + 1) / nth;
+      reduce(ith, i0, i1);
+      barrier();
+      scan(ith, i0, i1);
+    });
+}
+
+
+
+}  // namespace dt
@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+#include <thread>     // std::this_thread
+#include "thpool3/api.h"
+#include "thpool3/task_group.h"
+#include "thpool3/thread_pool.h"
+#include "thpool3/thread_team.h"
+namespace dt3 {
+
+
+task_group::task_group()
+  : top(0),
+    bottom(0),
+    n_pending(0),
+    cancelled(false),
+    registered(false)
+{
+  for (task& t : slots) {
+    t.invoke = nullptr;
+    t.busy.store(false, std::memory_order_relaxed);
+  }
+}
+
+
+task_group::~task_group() {
+  if (!registered) return;
+  try {
+    wait();
+  } catch (...) {}
+}
+
+
+
+//------------------------------------------------------------------------------
+// Deque of tasks
+//------------------------------------------------------------------------------
+
+/**
+ * The tasks form a Chase-Lev deque (see `range_deque` in
+ * "parallel_for_dynamic.cc"), whose slots hold the closures themselves.
+ * Since a stolen task is executed in place, a slot cannot be reused until
+ * the task in it has finished: this is what the `busy` flag is for. When
+ * the next slot is still busy, or the deque is full, the new task is run
+ * inline by `spawn()`.
+ *
+ * From the master thread nothing runs until `wait()` is called, so instead
+ * of running the task inline the tasks spawned so far are executed first.
+ */
+task_group::task* task_group::next_slot() {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  if (b - top.load(std::memory_order_acquire) >= CAPACITY) {
+    if (thpool->in_parallel_region()) return nullptr;
+    wait();
+    b = bottom.load(std::memory_order_relaxed);
+  }
+  task* t = &slots[b % CAPACITY];
+  if (t->busy.load(std::memory_order_acquire)) return nullptr;
+  return t;
+}
+
+
+void task_group::push() {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  slots[b % CAPACITY].busy.store(true, std::memory_order_relaxed);
+  n_pending.fetch_add(1, std::memory_order_relaxed);
+  if (!registered) {
+    thpool->add_task_group(this);
+    registered = true;
+  }
+  bottom.store(b + 1, std::memory_order_release);
+  if (thpool->in_parallel_region()) {
+    thpool->wake_idle_threads(1);
+  }
+}
+
+
+task_group::task* task_group::pop() noexcept {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b);  // seq_cst: must be visible before `top` is read
+  int64_t t = top.load();
+  if (t > b) {
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  task* res = &slots[b % CAPACITY];
+  if (t < b) return res;
+  // Last task in the deque: race against the thieves for it
+  bool won = top.compare_exchange_strong(t, t + 1);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return won? res : nullptr;
+}
+
+
+task_group::task* task_group::steal() noexcept {
+  int64_t t = top.load();
+  int64_t b = bottom.load();
+  if (t >= b) return nullptr;
+  if (!top.compare_exchange_strong(t, t + 1)) return nullptr;
+  return &slots[t % CAPACITY];
+}
+
+
+
+
+//------------------------------------------------------------------------------
+// Execution
+//------------------------------------------------------------------------------
+
+// The tasks are run with no current team, same as the bodies of parallel
+// loops: the parallel constructs called from a task start nested regions.
+void task_group::execute(task* t) noexcept {
+  {
+    team_scope scope(nullptr);
+    try {
+      t->invoke(t, !cancelled.load(std::memory_order_relaxed));
+    } catch (...) {
+      save_exception();
+    }
+  }
+  t->busy.store(false, std::memory_order_release);
+  n_pending.fetch_sub(1, std::memory_order_release);
+}
+
+
+void task_group::run_inline(dt::function<void()> fn) noexcept {
+  if (cancelled.load(std::memory_order_relaxed)) return;
+  team_scope scope(nullptr);
+  try {
+    fn();
+  } catch (...) {
+    save_exception();
+  }
+}
+
+
+void task_group::save_exception() noexcept {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!saved_exception) saved_exception = std::current_exception();
+  cancelled.store(true);
+}
+
+
+/**
+ * From the master thread, the pool is started with a parallel region, in
+ * which the master runs the group's tasks as their owner, and the other
+ * threads steal them. Otherwise the current thread waits for the group
+ * alone, and the idle threads of the pool help via
+ * `thread_pool::run_nested_task()`.
+ */
+void task_group::wait() {
+  if (registered && !thpool->in_parallel_region()) {
+    std::thread::id owner = std::this_thread::get_id();
+    parallel_region(
+      [&] {
+        run_until_done(std::this_thread::get_id() == owner);
+      });
+  } else {
+    run_until_done(true);
+  }
+}
+
+
+void task_group::run_until_done(bool owner) {
+  if (owner) {
+    while (task* t = pop()) execute(t);
+  }
+  while (n_pending.load(std::memory_order_acquire) > 0) {
+    task* t = steal();
+    if (t) execute(t);
+    else if (!thpool->run_nested_task()) std::this_thread::yield();
+  }
+  if (!owner) return;
+
+  if (registered) {
+    thpool->remove_task_group(this);
+    registered = false;
+  }
+  cancelled.store(false);
+  if (saved_exception) {
+    std::exception_ptr e = saved_exception;
+    saved_exception = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+
+} // namespace dt
@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+#ifndef dt3_PARALLEL_TASK_GROUP_h
+#define dt3_PARALLEL_TASK_GROUP_h
+#include <atomic>
+#include <cstddef>
+#include <cstdint>        // int64_t
+#include <cstring>        // std::memcpy
+#include <exception>      // std::exception_ptr
+#include <mutex>          // std::mutex
+#include <new>            // placement new
+#include <type_traits>    // std::decay, std::integral_constant
+#include <utility>        // std::forward
+#include "utils/function.h"
+namespace dt3 {
+using std::size_t;
+
+class thread_pool;
+
+
+/**
+ * Fork-join group of tasks, for recursive algorithms (divide and conquer,
+ * quicksort / merge sort, MSD radix recursion, etc):
+ *
+ *     task_group tg;
+ *     tg.spawn([&]{ sort(lo, mid); });
+ *     tg.spawn([&]{ sort(mid, hi); });
+ *     tg.wait();
+ *
+ * The spawned tasks are pushed into the group's own deque, from which the
+ * thread that created the group pops them (newest first) once it calls
+ * `wait()`, while the other threads of the pool steal them from the other
+ * end (oldest, i.e. usually largest, first). A thread that waits for its
+ * group and has no tasks of its own left helps with the tasks of other
+ * groups and nested regions instead of blocking, so a recursion where every
+ * task creates its own group keeps all threads busy.
+ *
+ * The closures are stored within the group itself, which is meant to be
+ * allocated on the stack: spawning a closure of up to TASK_STORAGE bytes
+ * does not allocate memory on the heap (larger closures are moved to the
+ * heap). The group holds at most CAPACITY tasks that have not finished yet;
+ * beyond that, `spawn()` runs the task immediately in the calling thread.
+ *
+ * Only the thread that created the group may spawn tasks into it; a task
+ * that wants to spawn subtasks should create a task_group of its own.
+ *
+ * The group may be used from the master thread, in which case the tasks
+ * start executing when `wait()` is called, on all threads of the pool; or
+ * from within a parallel region / parallel loop, in which case the idle
+ * threads of the pool are woken up to steal tasks as soon as they are
+ * spawned. The tasks themselves may use any of the parallel constructs
+ * (which run as nested regions).
+ *
+ * If a task throws an exception, the tasks of the group that have not
+ * started yet are skipped, and the first exception is re-thrown by `wait()`.
+ * From the master thread, the exception is re-thrown within the pool's job,
+ * so that it goes through the pool's regular exception handling (see
+ * `idle_job::catch_exception()`).
+ */
+class task_group {
+  friend class thread_pool;
+  public:
+    static constexpr size_t TASK_STORAGE = 48;
+    static constexpr int64_t CAPACITY = 32;
+
+  private:
+    struct task {
+      // Run (if the second argument is true) and then destroy the closure
+      void (*invoke)(task*, bool);
+      // The slot is occupied by a task that has not finished yet
+      std::atomic<bool> busy;
+      alignas(16) unsigned char storage[TASK_STORAGE];
+    };
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<size_t> n_pending;
+    std::atomic<bool> cancelled;
+    bool registered;
+    size_t : 56;
+    std::mutex mutex;
+    std::exception_ptr saved_exception;
+    task slots[CAPACITY];
+
+  public:
+    task_group();
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+    // Waits for the tasks that are still running; their exceptions, if any,
+    // are discarded.
+    ~task_group();
+
+    template <typename F>
+    void spawn(F&& f) {
+      using Fn = typename std::decay<F>::type;
+      task* t = next_slot();
+      if (!t) {
+        run_inline(f);
+        return;
+      }
+      constexpr bool fits = sizeof(Fn) <= TASK_STORAGE && alignof(Fn) <= 16;
+      store<Fn>(t, std::forward<F>(f), std::integral_constant<bool, fits>());
+      push();
+    }
+
+    // Wait until all tasks spawned so far are finished, running them in the
+    // current thread, or helping other threads while they are being run
+    // elsewhere. Re-throws the exception of the first task that failed.
+    void wait();
+
+  private:
+    task* next_slot();
+    void push();
+    task* pop() noexcept;
+    task* steal() noexcept;
+    void execute(task*) noexcept;
+    void run_inline(dt::function<void()>) noexcept;
+    void run_until_done(bool owner);
+    void save_exception() noexcept;
+
+    template <typename Fn, typename F>
+    static void store(task* t, F&& f, std::true_type) {
+      new (t->storage) Fn(std::forward<F>(f));
+      t->invoke = invoke_inline<Fn>;
+    }
+
+    template <typename Fn, typename F>
+    static void store(task* t, F&& f, std::false_type) {
+      Fn* p = new Fn(std::forward<F>(f));
+      std::memcpy(t->storage, &p, sizeof(p));
+      t->invoke = invoke_heap<Fn>;
+    }
+
+    template <typename Fn>
+    struct destroyer {
+      Fn* fn;
+      bool heap;
+      ~destroyer() { if (heap) delete fn; else fn->~Fn(); }
+    };
+
+    template <typename Fn>
+    static void invoke_inline(task* t, bool run) {
+      destroyer<Fn> d {reinterpret_cast<Fn*>(t->storage), false};
+      if (run) (*d.fn)();
+    }
+
+    template <typename Fn>
+    static void invoke_heap(task* t, bool run) {
+      Fn* p;
+      std::memcpy(&p, t->storage, sizeof(p));
+      destroyer<Fn> d {p, true};
+      if (run) (*p)();
+    }
+};
+
+
+} // namespace dt
+#endif
@@ -13,9 +13,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //------------------------------------------------------------------------------
-#include <thread>      // std::thread::hardware_concurrency
+#include <algorithm>   // std::find
+#include <thread>      // std::thread::hardware_concurrency, std::this_thread
 #include <pthread.h>   // pthread_atfork
 #include "thpool3/api.h"
+#include "thpool3/task_group.h"
 #include "thpool3/thread_pool.h"
 #include "thpool3/thread_team.h"
 #include "thpool3/thread_worker.h"
@@ -45,7 +47,9 @@ static bool after_fork_handler_registered = false;
 
 thread_pool::thread_pool()
   : num_threads_requested(0),
-    current_team(nullptr)
+    current_team(nullptr),
+    n_nested_jobs(0),
+    n_task_groups(0)
 {
   if (!after_fork_handler_registered) {
     pthread_atfork(nullptr, nullptr, _child_cleanup_after_fork);
@@ -115,17 +119,132 @@ void thread_pool::execute_job(thread_scheduler* job) {
 }
 
 
+/**
+ * The tasks of a nested job are claimed under `nested_mutex`, and the job is
+ * removed from `nested_jobs` when its last task is claimed: a job cannot be
+ * destroyed while a thread is looking at it, and once all of its tasks have
+ * been claimed the idle workers stop looking for it.
+ *
+ * The thread that started the job then claims the remaining tasks itself.
+ * Once there are none left, it helps with the tasks of other nested jobs
+ * (typically, the ones started by its own tasks that run elsewhere) until
+ * all tasks of its job are finished.
+ */
+void thread_pool::execute_nested(nested_job* job) {
+  {
+    std::lock_guard<std::mutex> lock(nested_mutex);
+    nested_jobs.push_back(job);
+    n_nested_jobs.store(nested_jobs.size());
+  }
+  controller.wake_idle_threads(job->size() - 1, workers.size());
+
+  size_t i;
+  while (job->claim(&i)) {
+    if (job->is_last(i)) {
+      std::lock_guard<std::mutex> lock(nested_mutex);
+      auto it = std::find(nested_jobs.begin(), nested_jobs.end(), job);
+      if (it != nested_jobs.end()) nested_jobs.erase(it);
+      n_nested_jobs.store(nested_jobs.size());
+    }
+    job->run(i);
+  }
+  while (!job->done()) {
+    if (!run_nested_task()) std::this_thread::yield();
+  }
+  job->rethrow();
+}
+
+
+bool thread_pool::run_nested_task() {
+  if (!has_nested_tasks()) return false;
+  nested_job* job = nullptr;
+  size_t i = 0;
+  {
+    std::lock_guard<std::mutex> lock(nested_mutex);
+    // Most recently started jobs first: these are the most deeply nested
+    // ones, which the other jobs are waiting for.
+    for (size_t k = nested_jobs.size(); k > 0; --k) {
+      nested_job* jk = nested_jobs[k - 1];
+      if (jk->claim(&i)) {
+        if (jk->is_last(i)) {
+          nested_jobs.erase(nested_jobs.begin() + static_cast<long>(k - 1));
+          n_nested_jobs.store(nested_jobs.size());
+        }
+        job = jk;
+        break;
+      }
+    }
+  }
+  if (job) {
+    job->run(i);
+    return true;
+  }
+  return run_task_group_task();
+}
+
+
+// The groups are scanned from the oldest, whose tasks are likely to be the
+// largest. A group is only removed from `task_groups` once all of its tasks
+// are finished, so the stolen task remains valid after the mutex is
+// released.
+bool thread_pool::run_task_group_task() {
+  if (n_task_groups.load(std::memory_order_relaxed) == 0) return false;
+  task_group* group = nullptr;
+  task_group::task* task = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(nested_mutex);
+    for (task_group* tg : task_groups) {
+      task = tg->steal();
+      if (task) {
+        group = tg;
+        break;
+      }
+    }
+  }
+  if (!group) return false;
+  group->execute(task);
+  return true;
+}
+
+
+bool thread_pool::has_nested_tasks() const noexcept {
+  return n_nested_jobs.load(std::memory_order_relaxed) > 0 ||
+         n_task_groups.load(std::memory_order_relaxed) > 0;
+}
+
+
+void thread_pool::add_task_group(task_group* tg) {
+  std::lock_guard<std::mutex> lock(nested_mutex);
+  task_groups.push_back(tg);
+  n_task_groups.store(task_groups.size());
+}
+
+
+void thread_pool::remove_task_group(task_group* tg) {
+  std::lock_guard<std::mutex> lock(nested_mutex);
+  auto it = std::find(task_groups.begin(), task_groups.end(), tg);
+  if (it != task_groups.end()) task_groups.erase(it);
+  n_task_groups.store(task_groups.size());
+}
+
+
+void thread_pool::wake_idle_threads(size_t n) {
+  controller.wake_idle_threads(n, workers.size());
+}
+
+
 bool thread_pool::in_parallel_region() const noexcept {
   return (current_team != nullptr);
 }
 
 size_t thread_pool::n_threads_in_team() const noexcept {
-  return current_team? current_team->size() : 0;
+  thread_team* tt = team_scope::current();
+  return tt? tt->size() : 0;
 }
 
 
 thread_team* thread_pool::get_team_unchecked() noexcept {
-  return thpool->current_team;
+  return team_scope::current();
 }
 
 
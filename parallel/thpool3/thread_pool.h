@@ -15,6 +15,7 @@
 //------------------------------------------------------------------------------
 #ifndef dt3_PARALLEL_THREAD_POOL_h
 #define dt3_PARALLEL_THREAD_POOL_h
+#include <atomic>              // std::atomic
 #include <mutex>               // std::mutex
 #include <thread>              // std::thread::id
 #include <vector>              // std::vector
@@ -25,6 +26,8 @@ using std::size_t;
 
 class thread_team;
 class idle_job;
+class nested_job;
+class task_group;
 
 
 /**
@@ -77,6 +80,21 @@ class thread_pool {
     // TODO: merge thread_team functionality into the pool?
     thread_team* current_team;
 
+    // Nested jobs that still have unclaimed tasks, protected by
+    // `nested_mutex`. `n_nested_jobs` is the size of this vector, and can be
+    // checked without locking the mutex.
+    std::vector<nested_job*> nested_jobs;
+    std::atomic<size_t> n_nested_jobs;
+    std::mutex nested_mutex;
+
+    // Task groups that have spawned tasks and not finished waiting for
+    // them yet, also protected by `nested_mutex`. Their tasks can be
+    // stolen by any thread (see "task_group.h").
+    std::vector<task_group*> task_groups;
+    std::atomic<size_t> n_task_groups;
+
+    bool run_task_group_task();
+
   public:
     thread_pool();
     thread_pool(const thread_pool&) = delete;
@@ -88,6 +106,24 @@ class thread_pool {
     void instantiate_threads();
     void execute_job(thread_scheduler*);
 
+    // Run a nested job from within the current job, and wait until it is
+    // finished. Idle workers are woken up to help with it, but only as many
+    // as there are threads in the pool not currently busy.
+    void execute_nested(nested_job*);
+
+    // Claim a task from any of the pending nested jobs, or steal one from
+    // the task groups, and run it. Returns false if there were no tasks to
+    // run.
+    bool run_nested_task();
+    bool has_nested_tasks() const noexcept;
+
+    void add_task_group(task_group*);
+    void remove_task_group(task_group*);
+
+    // Wake up to `n` idle workers while a job is running, so that they can
+    // help with nested jobs / task groups.
+    void wake_idle_threads(size_t n);
+
     size_t size() const noexcept;
     void resize(size_t n);
 
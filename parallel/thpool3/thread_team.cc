@@ -17,7 +17,8 @@
 #include "thpool3/thread_pool.h"
 #include "thpool3/thread_scheduler.h"
 #include "thpool3/thread_team.h"
-#include "utils/exceptions.h"
+#include "thpool3/thread_worker.h"     // _set_thread_num
+#include "utils/assert.h"
 namespace dt3 {
 
 
@@ -25,17 +26,19 @@ thread_team::thread_team(size_t nth, thread_pool* pool)
   : nthreads(nth),
     thpool(pool),
     nested_scheduler(nullptr),
-    barrier_counter {0}
+    barrier_counter {0},
+    nested(pool->current_team != nullptr)
 {
-  if (thpool->current_team) {
-    throw RuntimeError() << "Unable to create a nested thread team";
+  if (!nested) {
+    thpool->current_team = this;
   }
-  thpool->current_team = this;
 }
 
 
 thread_team::~thread_team() {
-  thpool->current_team = nullptr;
+  if (!nested) {
+    thpool->current_team = nullptr;
+  }
   auto tmp = nested_scheduler.load();
   delete tmp;
 }
@@ -45,8 +48,14 @@ size_t thread_team::size() const noexcept {
   return nthreads;
 }
 
+bool thread_team::is_nested() const noexcept {
+  return nested;
+}
+
 
 void thread_team::wait_at_barrier() {
+  // The tasks of a nested region may run one after another
+  xassert(!nested);
   size_t n = barrier_counter.fetch_add(1);
   size_t n_target = n - (n % nthreads) + nthreads;
   while (barrier_counter.load() < n_target);
@@ -58,4 +67,84 @@ void barrier() {
 }
 
 
+
+
+//------------------------------------------------------------------------------
+// team_scope
+//------------------------------------------------------------------------------
+
+static thread_local thread_team* thread_current_team = nullptr;
+
+team_scope::team_scope(thread_team* tt) noexcept
+  : prev_team(thread_current_team)
+{
+  thread_current_team = tt;
+}
+
+team_scope::~team_scope() {
+  thread_current_team = prev_team;
+}
+
+thread_team* team_scope::current() noexcept {
+  return thread_current_team;
+}
+
+
+
+
+//------------------------------------------------------------------------------
+// nested_job
+//------------------------------------------------------------------------------
+
+nested_job::nested_job(size_t ntasks_, dt::function<void()> fn_)
+  : team(ntasks_, thpool),
+    fn(fn_),
+    ntasks(ntasks_),
+    next_task(0),
+    n_done(0) {}
+
+
+bool nested_job::claim(size_t* i) noexcept {
+  *i = next_task.fetch_add(1);
+  return *i < ntasks;
+}
+
+bool nested_job::is_last(size_t i) const noexcept {
+  return i == ntasks - 1;
+}
+
+size_t nested_job::size() const noexcept {
+  return ntasks;
+}
+
+
+void nested_job::run(size_t i) noexcept {
+  size_t ith = this_thread_index();
+  _set_thread_num(i);
+  {
+    team_scope scope(&team);
+    try {
+      fn();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!saved_exception) saved_exception = std::current_exception();
+    }
+  }
+  _set_thread_num(ith);
+  n_done.fetch_add(1, std::memory_order_release);
+}
+
+
+bool nested_job::done() const noexcept {
+  return n_done.load(std::memory_order_acquire) == ntasks;
+}
+
+
+void nested_job::rethrow() {
+  if (saved_exception) {
+    std::rethrow_exception(saved_exception);
+  }
+}
+
+
 } // namespace dt
@@ -17,7 +17,10 @@
 #define dt3_PARALLEL_THREAD_TEAM_h
 #include <atomic>
 #include <cstddef>
+#include <exception>      // std::exception_ptr
+#include <mutex>          // std::mutex
 #include "thpool3/thread_pool.h"
+#include "utils/function.h"
 namespace dt3 {
 using std::size_t;
 
@@ -27,6 +30,15 @@ class thread_scheduler;
 
 
 
+/**
+ * A team of threads executing a parallel region. The outermost team is
+ * registered with the thread pool (it is `thread_pool::current_team`) and
+ * occupies the pool's workers; teams created while the pool is busy are
+ * "nested", and execute via a `nested_job` (see below).
+ *
+ * Each thread knows the team whose region-level code it is currently
+ * running, see `team_scope`.
+ */
 class thread_team {
   private:
     size_t nthreads;
@@ -34,12 +46,15 @@ class thread_team {
     std::atomic<thread_scheduler*> nested_scheduler;
 
     std::atomic<size_t> barrier_counter;
+    bool nested;
+    size_t : 56;
 
   public:
     thread_team(size_t nth, thread_pool*);
     ~thread_team();
 
     size_t size() const noexcept;
+    bool is_nested() const noexcept;
 
     template <typename S, typename... Args>
     S* shared_scheduler(Args&&... args) {
@@ -59,5 +74,68 @@ class thread_team {
 };
 
 
+
+/**
+ * Sets the team of the current thread for the lifetime of this object,
+ * restoring the previous one afterwards.
+ *
+ * Region-level code (the function passed to `parallel_region()`) runs with
+ * its team set, and the parallel constructs called from it are shared by the
+ * whole team. Loop bodies run with no team (nullptr): a parallel construct
+ * called from a loop body is independent of the other iterations, and starts
+ * a nested region.
+ */
+class team_scope {
+  private:
+    thread_team* prev_team;
+
+  public:
+    explicit team_scope(thread_team*) noexcept;
+    team_scope(const team_scope&) = delete;
+    ~team_scope();
+
+    static thread_team* current() noexcept;
+};
+
+
+
+/**
+ * A parallel region started while the thread pool is already busy. The
+ * region's function has to be run `ntasks` times, with thread indices
+ * `0 .. ntasks-1`; each such run is a task that may be claimed by any
+ * thread: the thread that started the region, idle workers of the pool
+ * that were woken up for it, and workers that finished their part of the
+ * enclosing job. The tasks are not guaranteed to run concurrently, so
+ * `barrier()` cannot be used within a nested region.
+ *
+ * An exception thrown by the region's function is saved, and re-thrown
+ * in the thread that started the region.
+ */
+class nested_job {
+  private:
+    thread_team team;
+    dt::function<void()> fn;
+    size_t ntasks;
+    std::atomic<size_t> next_task;
+    std::atomic<size_t> n_done;
+    std::mutex mutex;
+    std::exception_ptr saved_exception;
+
+  public:
+    nested_job(size_t ntasks, dt::function<void()> fn);
+
+    // Claim the next task; returns false if all tasks were claimed already.
+    // The thread that claims the last task should unregister the job from
+    // the thread pool.
+    bool claim(size_t* i) noexcept;
+    bool is_last(size_t i) const noexcept;
+    size_t size() const noexcept;
+
+    void run(size_t i) noexcept;
+    bool done() const noexcept;
+    void rethrow();
+};
+
+
 } // namespace dt
 #endif
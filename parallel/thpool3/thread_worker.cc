@@ -13,6 +13,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //------------------------------------------------------------------------------
+#include <algorithm>    // std::min
 #include <iostream>
 #include "thpool3/thread_worker.h"
 #include "thpool3/thread_pool.h"
@@ -120,20 +121,36 @@ idle_job::sleep_task::sleep_task(idle_job* ij)
 void idle_job::sleep_task::execute(thread_worker* worker) {
   controller->n_threads_running--;
   semaphore.wait();
-  xassert(next_scheduler);
-  worker->scheduler = next_scheduler;
+  // If there is no next scheduler, then the thread was woken up by
+  // `wake_idle_threads()`, and stays with the controller, which will give
+  // it nested tasks to run.
+  if (next_scheduler) {
+    worker->scheduler = next_scheduler;
+  }
+}
+
+
+// A task group remains registered while its tasks are running, even if
+// there are none left to steal; the worker should not spin in that case.
+// It will be woken up again when more tasks are spawned.
+void idle_job::nested_task::execute(thread_worker* worker) {
+  if (!thpool->run_nested_task()) {
+    controller->curr_sleep_task->execute(worker);
+  }
 }
 
 
 idle_job::idle_job() {
   curr_sleep_task = new sleep_task(this);
   prev_sleep_task = new sleep_task(this);
+  help_nested.controller = this;
   n_threads_running = 0;
   // monitor = std::unique_ptr<monitor_thread>(new monitor_thread(this));
 }
 
 
 thread_task* idle_job::get_next_task(size_t) {
+  if (thpool->has_nested_tasks()) return &help_nested;
   return curr_sleep_task;
 }
 
@@ -179,19 +196,47 @@ void idle_job::awaken_and_run(thread_scheduler* job, size_t nthreads) {
 // Wait until all threads go back to sleep (which would mean the job is done)
 void idle_job::join() {
   // Busy-wait until all threads finish running
-  while (n_threads_running.load() != 0);
+  while (n_threads_running.load() != 0) {
+    thpool->run_nested_task();
+  }
 
   // Clear `.next_scheduler` flag of the previous sleep task, indicating that
   // we no longer run in a parallel region (see `is_running()`).
   prev_sleep_task->next_scheduler = nullptr;
   // monitor->set_active(false);
 
+  // The exception is re-thrown only once: `join()` is also called when the
+  // pool is resized, and that must not raise the error of an earlier job.
   if (saved_exception) {
-    std::rethrow_exception(saved_exception);
+    std::exception_ptr e = saved_exception;
+    saved_exception = nullptr;
+    std::rethrow_exception(e);
   }
 }
 
 
+/**
+ * Each thread that is woken up is counted as running from the moment it is
+ * signaled, exactly as in `awaken_and_run()`; `join()` therefore cannot
+ * return while the woken threads are still helping. The number of threads
+ * to wake is reserved with a CAS, so that concurrent nested jobs cannot
+ * wake more threads than there are asleep.
+ *
+ * During a job, the idle workers sleep on `curr_sleep_task`, which is only
+ * modified by `awaken_and_run()` when no job is running.
+ */
+void idle_job::wake_idle_threads(size_t n, size_t nworkers) {
+  int n_asleep_max = static_cast<int>(nworkers) - 1;
+  int curr = n_threads_running.load();
+  int k;
+  do {
+    k = std::min(static_cast<int>(n), n_asleep_max - curr);
+    if (k <= 0) return;
+  } while (!n_threads_running.compare_exchange_weak(curr, curr + k));
+  curr_sleep_task->semaphore.signal(k);
+}
+
+
 void idle_job::set_master_worker(thread_worker* worker) noexcept {
   master_worker = worker;
 }
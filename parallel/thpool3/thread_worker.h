@@ -127,10 +127,21 @@ class idle_job : public thread_scheduler {
       void execute(thread_worker* worker) override;
     };
 
+    // Task given to workers while there are pending nested jobs or task
+    // groups: it runs one of their tasks (see
+    // `thread_pool::run_nested_task()`), or puts the worker to sleep if
+    // there was nothing to run.
+    struct nested_task : public thread_task {
+      idle_job* controller;
+      void execute(thread_worker* worker) override;
+    };
+
     // "Current" sleep task, meaning that all sleeping threads are executing
     // `curr_sleep_task->execute()`.
     sleep_task* curr_sleep_task;
 
+    nested_task help_nested;
+
     // The "previous" sleep task. The pointers `prev_sleep_task` and
     // `curr_sleep_task` flip-flop.
     sleep_task* prev_sleep_task;
@@ -164,8 +175,16 @@ class idle_job : public thread_scheduler {
     // work is finished and all worker threads have been put to sleep. If there
     // was an exception during execution of any of the tasks, this exception
     // will be rethrown here (but only after all workers were put to sleep).
+    // While waiting, the master thread helps with the nested jobs, if any.
     void join();
 
+    // Called from any thread while a job is running, this function wakes up
+    // to `n` of the workers that are asleep (there are `nworkers` workers
+    // in total, including the master) so that they can help with nested
+    // jobs. The workers that are counted as running are never woken, so
+    // the pool is not oversubscribed.
+    void wake_idle_threads(size_t n, size_t nworkers);
+
     // Called from worker threads, within the `catch(...){ }` block, this method
     // is used to signal that an exception have occurred. The method will save
     // this exception, so that it can be re-thrown after the parallel region
@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//------------------------------------------------------------------------------
+#ifndef dt_UTILS_BENCH_REPORT_h
+#define dt_UTILS_BENCH_REPORT_h
+#include <algorithm>   // std::sort
+#include <cmath>       // std::sqrt, std::floor, std::ceil
+#include <cstdio>      // std::FILE, std::fopen, std::fprintf
+#include <ctime>       // std::time, std::gmtime, std::strftime
+#include <fstream>     // std::ifstream
+#include <string>
+#include <thread>      // std::thread::hardware_concurrency
+#include <utility>     // std::pair
+#include <vector>
+#include <unistd.h>    // gethostname
+#include <sys/utsname.h>
+namespace dt {
+
+
+/**
+ * Summary statistics of a set of timing samples (in seconds).
+ *
+ * `ci_lo` .. `ci_hi` is the distribution-free 95% confidence interval of
+ * the median, computed from the order statistics of the sample.
+ */
+struct bench_stats {
+  size_t n;
+  double mean, stdev;
+  double min, p05, p25, median, p75, p95, max;
+  double ci_lo, ci_hi;
+
+  explicit bench_stats(std::vector<double> s) {
+    std::sort(s.begin(), s.end());
+    n = s.size();
+    if (n == 0) {
+      mean = stdev = min = p05 = p25 = median = p75 = p95 = max = 0;
+      ci_lo = ci_hi = 0;
+      return;
+    }
+    double sum = 0, ssq = 0;
+    for (double v : s) sum += v;
+    mean = sum / n;
+    for (double v : s) ssq += (v - mean) * (v - mean);
+    stdev = n > 1? std::sqrt(ssq / (n - 1)) : 0.0;
+    min = s.front();
+    max = s.back();
+    p05 = quantile(s, 0.05);
+    p25 = quantile(s, 0.25);
+    median = quantile(s, 0.5);
+    p75 = quantile(s, 0.75);
+    p95 = quantile(s, 0.95);
+    double half = 0.98 * std::sqrt(static_cast<double>(n));
+    double lo = std::floor(n / 2.0 - half);
+    double hi = std::ceil(n / 2.0 + half);
+    ci_lo = s[lo < 0? 0 : static_cast<size_t>(lo)];
+    ci_hi = s[hi > n - 1? n - 1 : static_cast<size_t>(hi)];
+  }
+
+  // Linear interpolation between the closest ranks of a sorted sample
+  static double quantile(const std::vector<double>& s, double q) {
+    double pos = q * (s.size() - 1);
+    size_t i = static_cast<size_t>(pos);
+    if (i + 1 >= s.size()) return s.back();
+    double frac = pos - i;
+    return s[i] * (1 - frac) + s[i + 1] * frac;
+  }
+};
+
+
+
+/**
+ * Collects the results of a benchmark run and writes them, together with
+ * the information about the host, into a JSON or CSV file. Each result is
+ * identified by its `name` plus a list of parameters (such as N, K or the
+ * number of threads); the raw samples are stored as well, so that two
+ * reports can be compared statistically (see utils/compare.py).
+ */
+class bench_report {
+  public:
+    using params_t = std::vector<std::pair<std::string, std::string>>;
+
+  private:
+    struct entry {
+      std::string name;
+      params_t params;
+      std::vector<double> samples;
+    };
+    std::string program;
+    std::vector<entry> entries;
+
+  public:
+    explicit bench_report(const std::string& prog) : program(prog) {}
+
+    void add(const std::string& name, const params_t& params,
+             const std::vector<double>& samples)
+    {
+      entries.push_back(entry{name, params, samples});
+    }
+
+    bool empty() const { return entries.empty(); }
+
+    // Write the report into `path`: CSV if the file name ends with ".csv",
+    // and JSON otherwise. Returns false if the file cannot be written.
+    bool save(const std::string& path) const {
+      std::FILE* out = std::fopen(path.c_str(), "w");
+      if (!out) return false;
+      bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+      if (csv) write_csv(out); else write_json(out);
+      std::fclose(out);
+      return true;
+    }
+
+  private:
+    static std::string escape(const std::string& s) {
+      std::string r;
+      for (char c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) { r += ' '; continue; }
+        r += c;
+      }
+      return r;
+    }
+
+    static std::string csv_quote(const std::string& s) {
+      std::string r = "\"";
+      for (char c : s) {
+        if (c == '"') r += '"';
+        r += c;
+      }
+      return r + "\"";
+    }
+
+    static std::string host_name() {
+      char buf[256] = {0};
+      gethostname(buf, sizeof(buf) - 1);
+      return buf;
+    }
+
+    static std::string cpu_model() {
+      std::ifstream in("/proc/cpuinfo");
+      std::string line;
+      while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+          size_t p = line.find(':');
+          if (p != std::string::npos) return line.substr(p + 2);
+        }
+      }
+      return "unknown";
+    }
+
+    static std::string os_name() {
+      struct utsname u;
+      if (uname(&u) != 0) return "unknown";
+      return std::string(u.sysname) + " " + u.release + " " + u.machine;
+    }
+
+    static std::string timestamp() {
+      char buf[32];
+      std::time_t t = std::time(nullptr);
+      std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
+      return buf;
+    }
+
+    void write_json(std::FILE* out) const {
+      std::fprintf(out, "{\n  \"program\": \"%s\",\n", escape(program).c_str());
+      std::fprintf(out, "  \"host\": {\n");
+      std::fprintf(out, "    \"hostname\": \"%s\",\n", escape(host_name()).c_str());
+      std::fprintf(out, "    \"cpu\": \"%s\",\n", escape(cpu_model()).c_str());
+      std::fprintf(out, "    \"ncpus\": %u,\n", std::thread::hardware_concurrency());
+      std::fprintf(out, "    \"os\": \"%s\",\n", escape(os_name()).c_str());
+      std::fprintf(out, "    \"compiler\": \"%s\",\n", escape(__VERSION__).c_str());
+      std::fprintf(out, "    \"timestamp\": \"%s\"\n", timestamp().c_str());
+      std::fprintf(out, "  },\n  \"results\": [");
+      for (size_t i = 0; i < entries.size(); ++i) {
+        const entry& e = entries[i];
+        bench_stats st(e.samples);
+        std::fprintf(out, "%s\n    {\"name\": \"%s\", \"params\": {",
+                     i? "," : "", escape(e.name).c_str());
+        for (size_t j = 0; j < e.params.size(); ++j) {
+          std::fprintf(out, "%s\"%s\": \"%s\"", j? ", " : "",
+                       escape(e.params[j].first).c_str(),
+                       escape(e.params[j].second).c_str());
+        }
+        std::fprintf(out, "},\n     \"n\": %zu, \"mean\": %.6g, \"stdev\": %.6g, "
+                          "\"min\": %.6g, \"p05\": %.6g, \"p25\": %.6g, "
+                          "\"median\": %.6g, \"p75\": %.6g, \"p95\": %.6g, "
+                          "\"max\": %.6g, \"ci95\": [%.6g, %.6g],\n"
+                          "     \"samples\": [",
+                     st.n, st.mean, st.stdev, st.min, st.p05, st.p25,
+                     st.median, st.p75, st.p95, st.max, st.ci_lo, st.ci_hi);
+        for (size_t j = 0; j < e.samples.size(); ++j) {
+          std::fprintf(out, "%s%.6g", j? ", " : "", e.samples[j]);
+        }
+        std::fprintf(out, "]}");
+      }
+      std::fprintf(out, "\n  ]\n}\n");
+    }
+
+    // One row per result; the parameters are joined into a single column
+    // as "key=value;key=value", and the samples are not included.
+    void write_csv(std::FILE* out) const {
+      std::fprintf(out, "# program=%s; host=%s; cpu=%s; ncpus=%u; os=%s; "
+                        "compiler=%s; timestamp=%s\n",
+                   program.c_str(), host_name().c_str(), cpu_model().c_str(),
+                   std::thread::hardware_concurrency(), os_name().c_str(),
+                   __VERSION__, timestamp().c_str());
+      std::fprintf(out, "name,params,n,mean,stdev,min,p05,p25,median,p75,"
+                        "p95,max,ci95_lo,ci95_hi\n");
+      for (const entry& e : entries) {
+        bench_stats st(e.samples);
+        std::string params;
+        for (const auto& kv : e.params) {
+          if (!params.empty()) params += ';';
+          params += kv.first + "=" + kv.second;
+        }
+        std::fprintf(out, "%s,%s,%zu,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,"
+                          "%.6g,%.6g,%.6g,%.6g\n",
+                     csv_quote(e.name).c_str(), csv_quote(params).c_str(), st.n, st.mean, st.stdev,
+                     st.min, st.p05, st.p25, st.median, st.p75, st.p95,
+                     st.max, st.ci_lo, st.ci_hi);
+      }
+    }
+};
+
+
+}  // namespace dt
+#endif
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+# Compare two benchmark reports written with --output (by ./sort or
+# ./parallel), and flag statistically significant regressions.
+#
+#     python compare.py BASELINE.json CURRENT.json [--threshold 5] [--alpha 0.01]
+#
+# A result is a regression when its median time grew by more than
+# `threshold` percent AND the difference is significant: for JSON reports
+# (which contain the raw samples) according to the two-sided Mann-Whitney U
+# test at level `alpha`; for CSV reports when the 95% confidence intervals of
+# the medians do not overlap. The exit code is 1 if any regressions were
+# found, and 2 if the two reports do not have the same set of results
+# (including when nothing could be compared) or a report has duplicate
+# results, so the script can be used as a gate.
+import argparse
+import csv
+import json
+import math
+import sys
+
+
+def params_key(params):
+    """Canonical form of the params of a result: "k=v" pairs sorted by k and
+    joined with ';'. `params` is either a dict (JSON), or the params string
+    from a CSV report, whose pairs are in the order they were added in."""
+    if isinstance(params, str):
+        params = dict(kv.split("=", 1) for kv in params.split(";") if kv)
+    return ";".join("%s=%s" % kv for kv in sorted(params.items()))
+
+
+def check_duplicate(results, key, path):
+    """Two results with the same name and params cannot be told apart: only
+    the last one would be compared."""
+    if key in results:
+        print("%s: duplicate result %s [%s]" % (path, key[0], key[1]),
+              file=sys.stderr)
+        sys.exit(2)
+
+
+def load(path):
+    """Return ({key: result}, host) where result has median/ci/samples."""
+    results = {}
+    if path.endswith(".csv"):
+        with open(path) as f:
+            header = f.readline().lstrip("# ").strip()
+            for row in csv.DictReader(f):
+                key = (row["name"], params_key(row["params"]))
+                check_duplicate(results, key, path)
+                results[key] = {
+                    "median": float(row["median"]),
+                    "ci95": [float(row["ci95_lo"]), float(row["ci95_hi"])],
+                    "samples": None,
+                }
+        return results, header
+    with open(path) as f:
+        data = json.load(f)
+    for r in data["results"]:
+        key = (r["name"], params_key(r["params"]))
+        check_duplicate(results, key, path)
+        results[key] = r
+    host = data.get("host", {})
+    return results, "%s (%s, %s cpus), %s" % (
+        host.get("hostname"), host.get("cpu"), host.get("ncpus"),
+        host.get("timestamp"))
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test (normal approximation
+    with tie correction)."""
+    n1, n2 = len(a), len(b)
+    if n1 < 2 or n2 < 2:
+        return 1.0
+    combined = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(combined)
+    tie_term = 0.0
+    i = 0
+    while i < len(combined):
+        j = i
+        while j + 1 < len(combined) and combined[j + 1][0] == combined[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        tie_term += t ** 3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, g) in zip(ranks, combined) if g == 0)
+    u1 = r1 - n1 * (n1 + 1) / 2.0
+    mu = n1 * n2 / 2.0
+    n = n1 + n2
+    sigma2 = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if sigma2 <= 0:
+        return 1.0
+    z = (abs(u1 - mu) - 0.5) / math.sqrt(sigma2)
+    return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="minimal slowdown, in percent (default 5)")
+    parser.add_argument("--alpha", type=float, default=0.01,
+                        help="significance level (default 0.01)")
+    args = parser.parse_args()
+
+    base, base_host = load(args.baseline)
+    curr, curr_host = load(args.current)
+    print("Baseline: %s" % base_host)
+    print("Current:  %s\n" % curr_host)
+
+    nregressions = 0
+    ncompared = 0
+    print("%-56s %12s %12s %8s %8s  %s" %
+          ("name", "baseline", "current", "change", "p", "verdict"))
+    for key in sorted(curr):
+        if key not in base:
+            continue
+        b, c = base[key], curr[key]
+        ncompared += 1
+        bm, cm = b["median"], c["median"]
+        change = (cm / bm - 1) * 100 if bm > 0 else 0.0
+        if b.get("samples") and c.get("samples"):
+            p = mann_whitney_p(b["samples"], c["samples"])
+            significant = p < args.alpha
+            ptxt = "%.4f" % p
+        else:
+            significant = (c["ci95"][0] > b["ci95"][1] or
+                           c["ci95"][1] < b["ci95"][0])
+            ptxt = "ci"
+        verdict = ""
+        if significant and change > args.threshold:
+            verdict = "REGRESSION"
+            nregressions += 1
+        elif significant and change < -args.threshold:
+            verdict = "improved"
+        name = key[0] if not key[1] else "%s [%s]" % key
+        print("%-56s %10.3fus %10.3fus %+7.1f%% %8s  %s" %
+              (name[:56], bm * 1e6, cm * 1e6, change, ptxt, verdict))
+    missing = [k for k in base if k not in curr]
+    added = [k for k in curr if k not in base]
+    if missing:
+        print("\n%d result(s) from the baseline are missing" % len(missing))
+    if added:
+        print("\n%d result(s) are not in the baseline" % len(added))
+    print("\n%d result(s) compared, %d regression(s) found" %
+          (ncompared, nregressions))
+    if nregressions:
+        return 1
+    if missing or added or not ncompared:
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,212 @@
+//------------------------------------------------------------------------------
+// Copyright 2019 H2O.ai
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//------------------------------------------------------------------------------
+#ifndef dt_UTILS_PERF_COUNTERS_h
+#define dt_UTILS_PERF_COUNTERS_h
+#include <cstdint>
+#include <cstdio>      // std::snprintf
+#include <cstring>     // std::memset
+#include <string>
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+namespace dt {
+
+
+/**
+ * Hardware performance counters (Linux perf_event_open) measured around a
+ * region of code:
+ *
+ *     perf_counters pc;
+ *     pc.start();
+ *     ... measured code ...
+ *     pc.stop();
+ *     printf("%s\n", pc.summary(niters).c_str());
+ *
+ * The counters follow the calling thread and every thread it spawns AFTER
+ * the object was constructed (reading the counter sums over all of them).
+ * Thus, in order to include the workers of a thread pool, the object must
+ * be created before the pool starts its threads.
+ *
+ * Each event is opened independently, so that events that the CPU or the
+ * kernel do not support (or that are forbidden by `perf_event_paranoid`,
+ * or not exposed inside a VM/container) are simply skipped. If no events
+ * are available then `available()` is false and `summary()` is empty.
+ */
+class perf_counters {
+  public:
+    enum Event {
+      CYCLES,
+      INSTRUCTIONS,
+      LLC_MISSES,
+      DTLB_MISSES,
+      BRANCH_MISSES,
+      NEVENTS
+    };
+
+  private:
+    int fds[NEVENTS];
+    uint64_t totals[NEVENTS];
+    bool any;
+
+  public:
+    perf_counters() : any(false) {
+      for (int i = 0; i < NEVENTS; ++i) {
+        fds[i] = open_event(static_cast<Event>(i));
+        any |= (fds[i] >= 0);
+      }
+      reset();
+    }
+
+    ~perf_counters() {
+      #ifdef __linux__
+        for (int i = 0; i < NEVENTS; ++i) {
+          if (fds[i] >= 0) close(fds[i]);
+        }
+      #endif
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    bool available() const { return any; }
+    bool has(Event e) const { return fds[e] >= 0; }
+    uint64_t value(Event e) const { return totals[e]; }
+
+    // Clear the accumulated values.
+    void reset() {
+      std::memset(totals, 0, sizeof(totals));
+    }
+
+    // Start counting. The values accumulate over all start()/stop() pairs
+    // since the last reset().
+    void start() {
+      #ifdef __linux__
+        for (int i = 0; i < NEVENTS; ++i) {
+          if (fds[i] < 0) continue;
+          ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+          ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+      #endif
+    }
+
+    void stop() {
+      #ifdef __linux__
+        for (int i = 0; i < NEVENTS; ++i) {
+          if (fds[i] < 0) continue;
+          ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+          uint64_t count = 0;
+          if (read(fds[i], &count, sizeof(count)) == sizeof(count)) {
+            totals[i] += count;
+          }
+        }
+      #endif
+    }
+
+    /**
+     * Human-readable summary of the accumulated values divided by `nruns`,
+     * for example "cycles=1.23M instr=2.46M IPC=2.00 LLC-miss=1.0K ...".
+     * Events that are not available are omitted.
+     */
+    std::string summary(double nruns = 1.0) const {
+      std::string out;
+      if (!any) return out;
+      static const char* names[NEVENTS] = {
+        "cycles", "instr", "LLC-miss", "dTLB-miss", "br-miss"
+      };
+      char buf[64];
+      for (int i = 0; i < NEVENTS; ++i) {
+        if (fds[i] < 0) continue;
+        out += names[i];
+        out += '=';
+        out += format_count(static_cast<double>(totals[i]) / nruns);
+        out += ' ';
+        if (i == INSTRUCTIONS && has(CYCLES) && totals[CYCLES]) {
+          std::snprintf(buf, sizeof(buf), "IPC=%.2f ",
+                        static_cast<double>(totals[INSTRUCTIONS]) /
+                        static_cast<double>(totals[CYCLES]));
+          out += buf;
+        }
+      }
+      out.pop_back();
+      return out;
+    }
+
+  private:
+    static std::string format_count(double v) {
+      char buf[32];
+      if (v >= 1e9)      std::snprintf(buf, sizeof(buf), "%.2fG", v * 1e-9);
+      else if (v >= 1e6) std::snprintf(buf, sizeof(buf), "%.2fM", v * 1e-6);
+      else if (v >= 1e3) std::snprintf(buf, sizeof(buf), "%.2fK", v * 1e-3);
+      else               std::snprintf(buf, sizeof(buf), "%.0f", v);
+      return std::string(buf);
+    }
+
+    static int open_event(Event e) {
+      #ifdef __linux__
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        switch (e) {
+          case CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+          case INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+          case LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+          case DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+          case BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+          default:
+            return -1;
+        }
+        long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        return static_cast<int>(fd);
+      #else
+        (void) e;
+        return -1;
+      #endif
+    }
+};
+
+
+}  // namespace dt
+#endif
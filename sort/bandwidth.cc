@@ -0,0 +1,81 @@
+//==============================================================================
+// Memory bandwidth probe
+//==============================================================================
+#include <algorithm>    // std::max
+#include <chrono>
+#include <stdint.h>
+#include "sort.h"
+
+// Number of repetitions of each probe; the fastest one is reported.
+static constexpr int PROBE_REPEATS = 3;
+
+// Number of buckets of the scatter probe: the same as a radix pass with 8
+// bits, so that the write streams stay within the L1 cache and the TLB.
+static constexpr int SCATTER_BUCKETS = 256;
+
+
+template <typename F>
+static double best_gbps(size_t nbytes, F run) {
+  using clock = std::chrono::steady_clock;
+  double best = 0;
+  for (int r = 0; r < PROBE_REPEATS; r++) {
+    auto t0 = clock::now();
+    run();
+    std::chrono::duration<double> t = clock::now() - t0;
+    if (t.count() > 0) best = std::max(best, nbytes / t.count() * 1e-9);
+  }
+  return best;
+}
+
+
+// Measures the single-threaded memory bandwidth with a STREAM-like copy, and
+// with a scatter into SCATTER_BUCKETS buckets (the access pattern of the
+// scatter pass of a radix sort). Both read `nbytes` and write `nbytes`; the
+// bandwidth counts the bytes read plus the bytes written, which is the same
+// convention as the traffic declared by the sort kernels.
+bandwidth_peak probe_bandwidth(size_t nbytes) {
+  size_t n = nbytes / sizeof(uint64_t);
+  uint64_t* src = static_cast<uint64_t*>(large_alloc(n * sizeof(uint64_t)));
+  uint64_t* dst = static_cast<uint64_t*>(large_alloc(n * sizeof(uint64_t)));
+  if (!src || !dst) {
+    large_free(src);
+    large_free(dst);
+    return bandwidth_peak {0, 0};
+  }
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < n; i++) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    src[i] = state * 0x2545F4914F6CDD1DULL;
+    dst[i] = 0;
+  }
+  size_t moved = 2 * n * sizeof(uint64_t);
+
+  bandwidth_peak peak;
+  peak.copy = best_gbps(moved, [=]{
+    for (size_t i = 0; i < n; i++) dst[i] = src[i];
+  });
+
+  // Bucket offsets are computed once, outside of the timed region
+  size_t offsets[SCATTER_BUCKETS] = {0};
+  for (size_t i = 0; i < n; i++) offsets[src[i] & (SCATTER_BUCKETS - 1)]++;
+  size_t cumsum = 0;
+  for (int b = 0; b < SCATTER_BUCKETS; b++) {
+    size_t h = offsets[b];
+    offsets[b] = cumsum;
+    cumsum += h;
+  }
+  peak.scatter = best_gbps(moved, [&]{
+    size_t pos[SCATTER_BUCKETS];
+    std::copy(offsets, offsets + SCATTER_BUCKETS, pos);
+    for (size_t i = 0; i < n; i++) {
+      uint64_t v = src[i];
+      dst[pos[v & (SCATTER_BUCKETS - 1)]++] = v;
+    }
+  });
+
+  large_free(src);
+  large_free(dst);
+  return peak;
+}
@@ -0,0 +1,122 @@
+//==============================================================================
+// Memory-mapped binary column files
+//==============================================================================
+#include <algorithm>    // std::min
+#include <cstring>      // std::memcmp
+#include <vector>       // std::vector
+#include <stdint.h>
+#include <stdio.h>
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap, madvise
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+#include "thpool3/api.h"
+#include "sort.h"
+
+static const char COLFILE_MAGIC[4] = {'S', 'C', 'O', 'L'};
+
+// On-disk header, followed immediately by `nrows` little-endian unsigned
+// integers of `elemsize` bytes each.
+struct colfile_header {
+  char magic[4];
+  uint32_t elemsize;
+  uint64_t nrows;
+};
+static_assert(sizeof(colfile_header) == COLFILE_HEADER_SIZE,
+              "Unexpected size of the column file header");
+
+
+// Map the file at `path` into memory (read-only) and validate its header.
+// On failure an error message is printed and false is returned.
+bool open_column_file(const char* path, column_file* cf) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("Cannot open file %s\n", path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < COLFILE_HEADER_SIZE) {
+    printf("File %s is too small to be a column file\n", path);
+    close(fd);
+    return false;
+  }
+  size_t filesize = static_cast<size_t>(st.st_size);
+  void* map = mmap(nullptr, filesize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("Cannot mmap file %s\n", path);
+    return false;
+  }
+
+  const colfile_header* header = static_cast<const colfile_header*>(map);
+  uint32_t elemsize = header->elemsize;
+  uint64_t nrows = header->nrows;
+  const char* error = nullptr;
+  if (std::memcmp(header->magic, COLFILE_MAGIC, 4) != 0) {
+    error = "invalid magic bytes";
+  } else if (elemsize != 1 && elemsize != 2 && elemsize != 4 && elemsize != 8) {
+    error = "unsupported element size";
+  } else if (nrows == 0) {
+    error = "no rows";
+  } else if (nrows > INT32_MAX) {
+    error = "too many rows";
+  } else if (COLFILE_HEADER_SIZE + nrows * elemsize > filesize) {
+    error = "file is truncated";
+  }
+  if (error) {
+    printf("Invalid column file %s: %s\n", path, error);
+    munmap(map, filesize);
+    return false;
+  }
+  // The data is read sequentially by the benchmark before each batch
+  madvise(map, filesize, MADV_SEQUENTIAL);
+
+  cf->data = static_cast<const char*>(map) + COLFILE_HEADER_SIZE;
+  cf->elemsize = static_cast<int>(elemsize);
+  cf->nrows = static_cast<int>(nrows);
+  cf->map = map;
+  cf->maplen = filesize;
+  return true;
+}
+
+
+void close_column_file(column_file* cf) {
+  if (cf->map) munmap(cf->map, cf->maplen);
+  cf->map = nullptr;
+  cf->data = nullptr;
+}
+
+
+// Number of significant bits in the data, i.e. the smallest K such that all
+// values are less than 1<<K. Computed from the bitwise OR of all values,
+// reduced in parallel.
+template <typename T>
+static int sig_bits(const T* x, int n) {
+  size_t nth = dt3::num_threads_in_pool();
+  size_t chunk = (static_cast<size_t>(n) + nth - 1) / nth;
+  std::vector<uint64_t> partial(nth, 0);
+  dt3::parallel_region(nth,
+    [&] {
+      size_t ith = dt3::this_thread_index();
+      size_t i0 = std::min(ith * chunk, size_t(n));
+      size_t i1 = std::min(i0 + chunk, size_t(n));
+      T acc = 0;
+      for (size_t i = i0; i < i1; i++) acc |= x[i];
+      partial[ith] = acc;
+    });
+  uint64_t all = 0;
+  for (uint64_t p : partial) all |= p;
+  int K = 0;
+  while (K < 64 && (all >> K)) K++;
+  return K;
+}
+
+int column_sig_bits(const column_file* cf) {
+  switch (cf->elemsize) {
+    case 1: return sig_bits(static_cast<const uint8_t*>(cf->data), cf->nrows);
+    case 2: return sig_bits(static_cast<const uint16_t*>(cf->data), cf->nrows);
+    case 4: return sig_bits(static_cast<const uint32_t*>(cf->data), cf->nrows);
+    case 8: return sig_bits(static_cast<const uint64_t*>(cf->data), cf->nrows);
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+//==============================================================================
+// Input data generators for the sort benchmark
+//==============================================================================
+#include <algorithm>    // std::min
+#include <cmath>        // std::exp, std::log
+#include <cstring>      // std::strcmp
+#include <stdint.h>
+#include "thpool3/api.h"
+#include "sort.h"
+
+// The data is generated in blocks of this many elements. Each block has its
+// own random stream derived from the seed and the block index, so the output
+// does not depend on the number of threads.
+static constexpr size_t DATAGEN_BLOCK = 1 << 14;
+
+// Number of distinct values in the DIST_FEW_UNIQUE data.
+static constexpr int FEW_UNIQUE_VALUES = 16;
+
+// Number of ascending runs in the DIST_SAWTOOTH data.
+static constexpr int SAWTOOTH_RUNS = 32;
+
+// Number of clusters in the DIST_CLUSTERED data.
+static constexpr int NCLUSTERS = 64;
+
+// Fraction of elements (in 1/1024ths) that are randomized in the
+// DIST_NOISY_SORTED data.
+static constexpr int NOISE_PER_1024 = 10;
+
+static const char* dist_names[] = {
+  "uniform", "zipf", "equal", "fewuniq", "sorted", "reversed", "noisy",
+  "sawtooth", "clustered"
+};
+
+
+const char* dist_name(int dist) {
+  return dist_names[dist];
+}
+
+int dist_from_name(const char* name) {
+  for (int d = 0; d < NDISTS; d++) {
+    if (!std::strcmp(name, dist_names[d])) return d;
+  }
+  return -1;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Random numbers
+//------------------------------------------------------------------------------
+
+static inline uint64_t splitmix64(uint64_t z) {
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// xorshift64* generator: a few cycles per number, and unlike rand() it can
+// be used from multiple threads at once.
+struct rng {
+  uint64_t state;
+
+  explicit rng(uint64_t seed) : state(splitmix64(seed) | 1) {}
+
+  uint64_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+
+  // Uniform double in [0, 1)
+  double next_double() {
+    return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+};
+
+
+
+//------------------------------------------------------------------------------
+// Generators
+//------------------------------------------------------------------------------
+
+// Generate `n` keys with `K` significant bits into `x`, drawn from
+// distribution `dist`. The same (dist, seed) always produces the same data.
+//
+// DIST_ZIPF draws ranks with P(r) ~ 1/r (approximated by inverting the
+// continuous CDF), and then scrambles them with an odd multiplier so that
+// the most frequent values are spread over the whole key range.
+template <typename T>
+void generate_data(T* x, int n, int K, int dist, uint64_t seed)
+{
+  uint64_t mask = K >= 64? ~uint64_t(0) : (uint64_t(1) << K) - 1;
+  uint64_t range = mask + 1;  // 0 when K == 64
+  uint64_t equal_value = splitmix64(seed) & mask;
+  uint64_t few_values[FEW_UNIQUE_VALUES];
+  uint64_t centers[NCLUSTERS];
+  for (int j = 0; j < FEW_UNIQUE_VALUES; j++) {
+    few_values[j] = splitmix64(seed + 1 + j) & mask;
+  }
+  for (int j = 0; j < NCLUSTERS; j++) {
+    centers[j] = splitmix64(seed + 101 + j) & mask;
+  }
+  uint64_t spread = (uint64_t(1) << (K / 2)) - 1;
+  double zipf_log = std::log(static_cast<double>(std::min(mask, uint64_t(1) << 40)) + 1.0);
+  size_t run = std::max(size_t(1), static_cast<size_t>(n) / SAWTOOTH_RUNS);
+
+  // Value at position `i` of an ascending sequence of length `len` spanning
+  // the whole key range.
+  auto ramp = [=](size_t i, size_t len) -> uint64_t {
+    if (range == 0) return (mask / len) * i;
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(i) * range) / len);
+  };
+
+  size_t nblocks = (static_cast<size_t>(n) + DATAGEN_BLOCK - 1) / DATAGEN_BLOCK;
+  dt3::parallel_for_static(nblocks, 1,
+    [&](size_t b) {
+      rng r(seed ^ splitmix64(b));
+      size_t i0 = b * DATAGEN_BLOCK;
+      size_t i1 = std::min(i0 + DATAGEN_BLOCK, static_cast<size_t>(n));
+      switch (dist) {
+        case DIST_UNIFORM:
+          for (size_t i = i0; i < i1; i++) x[i] = static_cast<T>(r.next() & mask);
+          break;
+        case DIST_ZIPF:
+          for (size_t i = i0; i < i1; i++) {
+            uint64_t rank = static_cast<uint64_t>(std::exp(r.next_double() * zipf_log));
+            x[i] = static_cast<T>(((rank - 1) * 0x9E3779B97F4A7C15ULL) & mask);
+          }
+          break;
+        case DIST_EQUAL:
+          for (size_t i = i0; i < i1; i++) x[i] = static_cast<T>(equal_value);
+          break;
+        case DIST_FEW_UNIQUE:
+          for (size_t i = i0; i < i1; i++) {
+            x[i] = static_cast<T>(few_values[r.next() % FEW_UNIQUE_VALUES]);
+          }
+          break;
+        case DIST_SORTED:
+          for (size_t i = i0; i < i1; i++) x[i] = static_cast<T>(ramp(i, n));
+          break;
+        case DIST_REVERSED:
+          for (size_t i = i0; i < i1; i++) x[i] = static_cast<T>(mask - ramp(i, n));
+          break;
+        case DIST_NOISY_SORTED:
+          for (size_t i = i0; i < i1; i++) {
+            uint64_t z = r.next();
+            bool noise = (z & 1023) < NOISE_PER_1024;
+            x[i] = static_cast<T>(noise? (z >> 10) & mask : ramp(i, n));
+          }
+          break;
+        case DIST_SAWTOOTH:
+          for (size_t i = i0; i < i1; i++) x[i] = static_cast<T>(ramp(i % run, run));
+          break;
+        case DIST_CLUSTERED:
+          for (size_t i = i0; i < i1; i++) {
+            uint64_t z = r.next();
+            uint64_t c = centers[z % NCLUSTERS];
+            x[i] = static_cast<T>((c + ((z >> 32) & spread)) & mask);
+          }
+          break;
+      }
+    });
+}
+
+
+template void generate_data(uint8_t*,  int, int, int, uint64_t);
+template void generate_data(uint16_t*, int, int, int, uint64_t);
+template void generate_data(uint32_t*, int, int, int, uint64_t);
+template void generate_data(uint64_t*, int, int, int, uint64_t);
@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
+#include <string>
 #include <vector>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,13 +11,68 @@
 #include <getopt.h>  // getopt
 #include <unistd.h>  // getopt_long
 #include <assert.h>
+#include <stdarg.h>
+#include "utils/bench_report.h"
+#include "utils/perf_counters.h"
+#include "radix_profile.h"
 #include "sort.h"
+#include "sort_cache.h"
 
-int tmp0 = 0;
 omem tmp1;
 omem tmp2;
 omem tmp3;
 
+// Distribution of the generated input data. When the --dist option is given,
+// the name of the distribution is appended to every reported algorithm name.
+static int data_dist = DIST_UNIFORM;
+static bool dist_suffix = false;
+
+// When set, the keys are taken from this buffer (a memory-mapped column
+// file) instead of being generated; it is never written to.
+static const void* input_data = nullptr;
+
+// Hardware counters for the timed iterations. This is constructed before
+// the thread pool starts, so that the parallel sorts are counted in full.
+static dt::perf_counters perf;
+
+// Results of all tests, saved into the --output file at the end
+static dt::bench_report report("sort");
+
+// Cache state of the input data at the start of each timed sort. In the
+// warm mode the data is sorted right after being restored from a fixed copy,
+// so it is cache-resident whenever it fits; in the cold mode the caches are
+// flushed before the sorts.
+enum CacheMode { CACHE_WARM, CACHE_COLD };
+static int cache_mode = CACHE_WARM;
+
+// Maximum size of the working copies in the cold mode (the copies are sorted
+// back to back, between two evictions).
+static constexpr size_t COLD_BATCH_BYTES = size_t(16) << 20;
+
+// Peak memory bandwidth measured at startup (zero if not measured), against
+// which the bandwidth achieved by each kernel is reported.
+static bandwidth_peak peak_bw {0, 0};
+
+static size_t llc_size() {
+  long sz = 0;
+  #ifdef _SC_LEVEL3_CACHE_SIZE
+    sz = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  #endif
+  return sz > 0? static_cast<size_t>(sz) : size_t(32) << 20;
+}
+
+// Evict all data from the CPU caches by reading a buffer twice as large as
+// the last-level cache. The sum is stored into a volatile and read back, so
+// that the loop cannot be optimized out.
+static void evict_caches() {
+  static std::vector<uint64_t> buffer(2 * llc_size() / sizeof(uint64_t), 1);
+  static volatile uint64_t sink = 0;
+  uint64_t acc = 0;
+  for (size_t i = 0; i < buffer.size(); i += 8) acc += buffer[i];
+  sink = acc;
+  (void) sink;
+}
+
 template <int s> struct _elt {};
 template <> struct _elt<8> { using t = uint64_t; };
 template <> struct _elt<4> { using t = uint32_t; };
@@ -28,9 +87,12 @@ using element_t = typename _elt<s>::t;
 // N: number of items in array x (i.e. number of items to be sorted)
 // K: max number of significant bits in elements x, this cannot exceed S*8
 // B:
+// bytes: theoretical memory traffic of one sort, in bytes per element (0 if
+//        unknown); used to report the achieved bandwidth.
 //
 template <int S, bool combined=false>
-int test(const char* algoname, sortfn_t sortfn, int N, int K, int B, int T, int seed)
+int test(const char* algoname, sortfn_t sortfn, int N, int K, int B, int T, int seed,
+         double bytes = 0)
 {
   using XT = element_t<S>;
   assert(K <= S*8);
@@ -39,67 +101,103 @@ int test(const char* algoname, sortfn_t sortfn, int N, int K, int B, int T, int
   int* o = nullptr, *wo = nullptr;
   xoitem<XT>* xo = nullptr, *wxo = nullptr;
 
+  // data to be sorted, and the ordering sorted together with the data
+  if (input_data) {
+    x = const_cast<XT*>(static_cast<const XT*>(input_data));
+  } else {
+    x = static_cast<XT*>(large_alloc(N * sizeof(XT)));
+  }
   if (combined) {
-    xo = new xoitem<XT>[N];
+    xo = static_cast<xoitem<XT>*>(large_alloc(N * sizeof(xoitem<XT>)));
+  } else {
+    o = static_cast<int*>(large_alloc(N * sizeof(int)));
+  }
+
+  // Working buffers: in the warm mode a single copy of the input which is
+  // restored before each sort; in the cold mode up to COLD_BATCH_BYTES worth
+  // of copies, which are restored all at once, evicted from the caches, and
+  // then sorted one after another.
+  size_t rowsize = combined? sizeof(xoitem<XT>) : sizeof(XT) + sizeof(int);
+  size_t nreplicas = 1;
+  if (cache_mode == CACHE_COLD) {
+    nreplicas = std::max(size_t(1), COLD_BATCH_BYTES / (N * rowsize));
+  }
+  if constexpr(combined) {
+    wxo = static_cast<xoitem<XT>*>(large_alloc(N * nreplicas * sizeof(xoitem<XT>)));
   } else {
-    x = new XT[N];   // data to be sorted
-    o = new int[N];  // ordering, sorted together with the data
+    wx = static_cast<XT*>(large_alloc(N * nreplicas * sizeof(XT)));
+    wo = static_cast<int*>(large_alloc(N * nreplicas * sizeof(int)));
   }
+  auto restore = [&](size_t r) {
+    if constexpr(combined) {
+      memcpy(wxo + r * N, xo, N * sizeof(xoitem<XT>));
+    } else {
+      memcpy(wx + r * N, x, N * sizeof(XT));
+      memcpy(wo + r * N, o, N * sizeof(int));
+    }
+  };
+  auto sort1 = [&](size_t r) {
+    if constexpr(combined) {
+      reinterpret_cast<sortfn2_t>(sortfn)(wxo + r * N, N, K);
+    } else {
+      sortfn(wx + r * N, wo + r * N, N, K);
+    }
+  };
+  // Time `niters` sorts, in seconds. The clock and the counters run only
+  // around the sorts themselves, never around the restores of the inputs.
+  auto measure = [&](size_t niters) -> double {
+    using clock = std::chrono::steady_clock;
+    std::chrono::duration<double> total(0);
+    if (cache_mode == CACHE_COLD) {
+      for (size_t done = 0; done < niters; ) {
+        size_t m = std::min(nreplicas, niters - done);
+        for (size_t r = 0; r < m; r++) restore(r);
+        evict_caches();
+        perf.start();
+        auto t0 = clock::now();
+        for (size_t r = 0; r < m; r++) sort1(r);
+        auto t1 = clock::now();
+        perf.stop();
+        total += t1 - t0;
+        done += m;
+      }
+    } else {
+      for (size_t i = 0; i < niters; i++) {
+        restore(0);
+        perf.start();
+        auto t0 = clock::now();
+        sort1(0);
+        auto t1 = clock::now();
+        perf.stop();
+        total += t1 - t0;
+      }
+    }
+    return total.count();
+  };
 
   size_t niters = 1;
+  size_t nsorts = 0;  // total number of timed sorts, across all batches
   double* ts = new double[B]();
   double tsum = 0;
   for (int b = 0; b < B; b++) {
     //----- Prepare data array -------------------------
-    srand(seed + b * 101);
-    XT mask = static_cast<XT>((1 << K) - 1);
-    XT* xx = (XT*) x;
+    if (!input_data) {
+      generate_data<XT>(x, N, K, data_dist, seed + b * 101);
+    }
     for (int i = 0; i < N; i++) {
-      XT z = static_cast<XT>(rand() & mask);
       if constexpr(combined) {
-        xo[i] = {z, i};
+        xo[i] = {x[i], i};
       } else {
-        xx[i] = z;
-        o[i]  = i;
+        o[i] = i;
       }
     }
 
     //----- Determine the number of iterations ---------
     bool done = (N >= 32768);
-    while (b == 0) {
-      if constexpr(combined) {
-        delete[] wxo;
-        wxo = new xoitem<XT>[N * niters];
-      } else {
-        delete[] wx;
-        delete[] wo;
-        wx = new XT[N * niters];
-        wo = new int[N * niters];
-      }
-      for (int i = 0; i < niters; i++) {
-        if constexpr(combined) {
-          memcpy(wxo + i * N, xo, N * sizeof(xoitem<XT>));
-        } else {
-          memcpy(wx + i * N, x, N * sizeof(XT));
-          memcpy(wo + i * N, o, N * sizeof(int));
-        }
-      }
-      if (done) break;
-      auto t0 = std::chrono::high_resolution_clock::now();
-      for (int i = 0; i < niters; i++) {
-        if constexpr(combined) {
-          xoitem<XT>* xoxo = wxo + i * N;
-          reinterpret_cast<sortfn2_t>(sortfn)(xoxo, N, K);
-        } else {
-          XT*  xx = wx + i * N;
-          int* oo = wo + i * N;
-          sortfn(xx, oo, N, K);
-        }
-      }
-      auto t1 = std::chrono::high_resolution_clock::now();
-      std::chrono::duration<double> delta = t1 - t0;
-      if (delta > std::chrono::milliseconds(1)) {
-        double time_per_iter = delta.count() / niters;
+    while (b == 0 && !done) {
+      double delta = measure(niters);
+      if (delta > 1e-3) {
+        double time_per_iter = delta / niters;
         niters = (int)(0.99 + T * 1e-3 / (time_per_iter * B));
         if (niters < 1) niters = 1;
         done = true;
@@ -109,22 +207,12 @@ int test(const char* algoname, sortfn_t sortfn, int N, int K, int B, int T, int
     }
 
     //----- Run the iterations -------------------------
-    auto t0 = std::chrono::high_resolution_clock::now();
-    if constexpr(combined) {
-      for (int i = 0; i < niters; i++) {
-        xoitem<XT>* xoxo = wxo + i * N;
-        reinterpret_cast<sortfn2_t>(sortfn)(xoxo, N, K);
-      }
-    } else {
-      for (int i = 0; i < niters; i++) {
-        XT*  xx = wx + i * N;
-        int* oo = wo + i * N;
-        sortfn(xx, oo, N, K);
-      }
+    if (b == 0) {
+      perf.reset();
+      RADIX_PROFILE_RESET();
     }
-    auto t1 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> delta = t1 - t0;
-    ts[b] = delta.count() / niters;
+    ts[b] = measure(niters) / niters;
+    nsorts += niters;
     tsum += ts[b];
     if ((tsum * 1000 > T && b >= 2) || tsum * 1000 > T * 3) {
       B = b + 1;
@@ -166,31 +254,879 @@ int test(const char* algoname, sortfn_t sortfn, int N, int K, int B, int T, int
     for (int b = 0; b < B; b++) sumt += ts[b];
     tavg = sumt / B;
   }
-  printf("[%s]  %.3f ns\n", algoname, tavg * 1e9);
+  char roofline[100] = "";
+  if (bytes > 0 && peak_bw.copy > 0 && tavg > 0) {
+    double gbps = bytes * N / tavg * 1e-9;
+    snprintf(roofline, sizeof(roofline),
+             "  %.2f GB/s = %.0f%% of copy, %.0f%% of scatter peak",
+             gbps, 100 * gbps / peak_bw.copy, 100 * gbps / peak_bw.scatter);
+  }
+  if (dist_suffix) {
+    printf("[%s@%s]  %.3f ns%s\n", algoname, dist_name(data_dist), tavg * 1e9, roofline);
+  } else {
+    printf("[%s]  %.3f ns%s\n", algoname, tavg * 1e9, roofline);
+  }
+  report.add(algoname,
+             {{"n", std::to_string(N)}, {"k", std::to_string(K)},
+              {"intsize", std::to_string(S)},
+              {"dist", input_data? "file" : dist_name(data_dist)},
+              {"cache", cache_mode == CACHE_COLD? "cold" : "warm"},
+              {"hugepages", std::to_string(get_huge_pages())}},
+             std::vector<double>(ts, ts + B));
+  if (perf.available()) {
+    printf("    %s\n", perf.summary(nsorts).c_str());
+  }
+  RADIX_PROFILE_PRINT(nsorts);
   // printf("Freeing x=%p, o=%p, wx=%p, wo=%p\n", x, o, wx, wo);
-  delete[] x;
-  delete[] o;
-  delete[] xo;
+  if (!input_data) large_free(x);
+  large_free(o);
+  large_free(xo);
+  large_free(wx);
+  large_free(wo);
+  large_free(wxo);
   delete[] ts;
   return 0;
 }
 
 
 
+//------------------------------------------------------------------------------
+// Categorical sort
+//------------------------------------------------------------------------------
+
+// Dictionary of categories for the categorical sort benchmark. The codes in
+// the input array are random numbers in the range [0, 1<<K), and each code
+// refers to one of the random strings below.
+static std::vector<std::string> cat_strings;
+static std::vector<const char*> cat_dict;
+static std::vector<int> cat_ranks;
+static int cat_nranks = 0;
+
+static void prepare_cat_dict(int ndict, int seed) {
+  srand(seed);
+  cat_strings.resize(ndict);
+  cat_dict.resize(ndict);
+  cat_ranks.resize(ndict);
+  for (int i = 0; i < ndict; i++) {
+    int len = 4 + rand() % 13;
+    std::string& s = cat_strings[i];
+    s.resize(len);
+    for (int j = 0; j < len; j++) s[j] = static_cast<char>('a' + rand() % 26);
+    cat_dict[i] = s.c_str();
+  }
+  // The dictionary is sorted only once, outside of the timed region
+  cat_nranks = cat_sort_ranks(cat_dict.data(), ndict, cat_ranks.data());
+}
+
+template <typename T>
+static void cat_sort_bench(T* x, int* o, int n, int) {
+  cat_sort0<T>(x, o, n, cat_ranks.data(), cat_nranks);
+}
+
+// Baseline: sort the codes by comparing their string values directly
+template <typename T>
+static void cat_strsort_bench(T* x, int* o, int n, int) {
+  const char* const* dict = cat_dict.data();
+  std::stable_sort(o, o + n,
+    [=](int a, int b) { return strcmp(dict[x[a]], dict[x[b]]) < 0; });
+}
+
+
+
+//------------------------------------------------------------------------------
+// Rank sort
+//------------------------------------------------------------------------------
+
+// Output buffers for the rank sort benchmarks
+static std::vector<int> rank_inv;
+static std::vector<int> rank_iranks;
+static std::vector<double> rank_franks;
+
+template <int M>
+static rank_t<M>* rank_buffer() {
+  if constexpr(M == RANK_AVERAGE) return rank_franks.data();
+  else return rank_iranks.data();
+}
+
+template <typename T, int M>
+static void rank_sort_bench(T* x, int* o, int n, int K) {
+  rank_sort<T, M>(x, o, n, K, rank_buffer<M>(), rank_inv.data());
+}
+
+template <typename T, int M>
+static void rank_sort_parallel_bench(T* x, int* o, int n, int K) {
+  rank_sort_parallel<T, M>(x, o, n, K, rank_buffer<M>(), rank_inv.data());
+}
+
+// Baseline: sort first, then derive the inverse ordering and the (min) ranks
+// from `o` in separate passes.
+template <typename T>
+static void rank_derive_bench(T* x, int* o, int n, int K) {
+  count_sort0<T>(x, o, n, K);
+  int* inv = rank_inv.data();
+  int* ranks = rank_iranks.data();
+  for (int i = 0; i < n; i++) {
+    inv[o[i]] = i;
+  }
+  for (int i = 0; i < n; i++) {
+    int prev = i? o[i - 1] : 0;
+    ranks[o[i]] = (i && x[o[i]] == x[prev])? ranks[prev] : i + 1;
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Radix sort
+//------------------------------------------------------------------------------
+
+// Number of radix bits for the first pass of radix1/radix3/radix4
+static int radix_bits = 0;
+
+// Limits of the sweeps over `radix_bits`: the first pass has at most
+// 1<<RADIX_MAX_BITS buckets, and the leaf sorts of radix1/radix3 can handle
+// at most RADIX_LEAF_BITS remaining bits (see bestsort() in radix_sort.cc).
+static constexpr int RADIX_MAX_BITS = 20;
+static constexpr int RADIX_LEAF_BITS = 16;
+
+// Start of a sweep over the radix bits in steps of `kstep`: the smallest
+// multiple of kstep that leaves at most RADIX_LEAF_BITS bits to the leaves.
+static int first_radix_bits(int K, int kstep) {
+  int k = std::max(kstep, K - RADIX_LEAF_BITS);
+  return (k + kstep - 1) / kstep * kstep;
+}
+
+template <typename T>
+static void radix_sort1_bench(T* x, int* o, int n, int K) {
+  radix_sort1<T>(x, o, n, K, radix_bits);
+}
+
+template <typename T>
+static void radix_sort3_bench(T* x, int* o, int n, int K) {
+  radix_sort3<T>(x, o, n, K, radix_bits);
+}
+
+template <typename T>
+static void radix_sort4_bench(T* x, int* o, int n, int K) {
+  radix_sort4<T>(x, o, n, K, radix_bits);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Quick sort
+//------------------------------------------------------------------------------
+
+// Unstable sort of the keys alone, for the callers that need no ordering
+template <typename T>
+static void quick_sort_keys_bench(T* x, int*, int n, int K) {
+  quick_sort<T>(x, nullptr, n, K);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Segmented sort
+//------------------------------------------------------------------------------
+
+// Groups of the segmented sort benchmarks: `seg_offsets` has the start of
+// each group, plus the end of the last one. Group sizes are uniform in
+// [1, 2*mean - 1].
+static std::vector<int> seg_offsets;
+static int seg_ngroups = 0;
+
+static void prepare_segments(int n, int mean, int seed) {
+  srand(seed);
+  seg_offsets.assign(1, 0);
+  while (seg_offsets.back() < n) {
+    int size = 1 + rand() % (2 * mean - 1);
+    seg_offsets.push_back(std::min(n, seg_offsets.back() + size));
+  }
+  seg_ngroups = static_cast<int>(seg_offsets.size()) - 1;
+}
+
+template <typename T>
+static void segmented_sort_bench(T* x, int* o, int, int K) {
+  segmented_sort<T>(x, o, seg_offsets.data(), seg_ngroups, K);
+}
+
+// Baseline: a separate radix_sort1 call for every group. radix_sort1 needs
+// between 1 and 16 bits left for the leaf sorts, and at most 20 radix bits.
+template <typename T>
+static void segmented_loop_bench(T* x, int* o, int, int K) {
+  int nbits = std::max(K - 16, std::min(K - 1, 8));
+  for (int g = 0; g < seg_ngroups; g++) {
+    int start = seg_offsets[g];
+    int size = seg_offsets[g + 1] - start;
+    if (size > 1) radix_sort1<T>(x + start, o + start, size, K, nbits);
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Indirect sort
+//------------------------------------------------------------------------------
+
+// Row-index vector of the view sorted by the indirect sort benchmarks, and
+// the buffer into which the baselines gather the keys of the view.
+static std::vector<int> view_rows;
+static std::vector<char> view_keys;
+
+// A filter that keeps each row with probability pct%, in the order of the
+// rows; or, if pct is 0, all the rows in a random order (as the result of an
+// earlier sort or join would be).
+static void prepare_view(int n, int pct, int S, int seed) {
+  srand(seed);
+  view_rows.clear();
+  if (pct) {
+    for (int i = 0; i < n; i++) {
+      if (rand() % 100 < pct) view_rows.push_back(i);
+    }
+  } else {
+    view_rows.resize(n);
+    for (int i = 0; i < n; i++) view_rows[i] = i;
+    for (int i = n - 1; i > 0; i--) std::swap(view_rows[i], view_rows[rand() % (i + 1)]);
+  }
+  view_keys.resize(view_rows.size() * S);
+  tmp1.ensure_size(2 * view_rows.size() * S);
+}
+
+template <typename T>
+static void indirect_radix_bench(T* x, int* o, int, int K) {
+  int n = static_cast<int>(view_rows.size());
+  std::memcpy(o, view_rows.data(), n * sizeof(int));
+  radix_sort4_indirect<T>(x, o, n, K, radix_bits);
+}
+
+template <typename T>
+static void indirect_merge_bench(T* x, int* o, int, int K) {
+  int n = static_cast<int>(view_rows.size());
+  std::memcpy(o, view_rows.data(), n * sizeof(int));
+  merge_sort0_indirect<T, 16>(x, o, n, K);
+}
+
+// Baselines: gather the keys of the view into a new array, then sort it
+template <typename T>
+static int gather_view(const T* x, int* o) {
+  int n = static_cast<int>(view_rows.size());
+  const int* rows = view_rows.data();
+  T* keys = reinterpret_cast<T*>(view_keys.data());
+  for (int i = 0; i < n; i++) {
+    keys[i] = x[rows[i]];
+    o[i] = rows[i];
+  }
+  return n;
+}
+
+template <typename T>
+static void gather_radix_bench(T* x, int* o, int, int K) {
+  int n = gather_view<T>(x, o);
+  radix_sort4<T>(reinterpret_cast<T*>(view_keys.data()), o, n, K, radix_bits);
+}
+
+template <typename T>
+static void gather_merge_bench(T* x, int* o, int, int K) {
+  int n = gather_view<T>(x, o);
+  merge_sort0<T, 16>(reinterpret_cast<T*>(view_keys.data()), o, n, K);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Sort result cache
+//------------------------------------------------------------------------------
+
+// The cache benchmarks sort their own column, which is generated once per
+// test: the inputs of the other benchmarks are regenerated in place for
+// every batch, which would make the cached results stale.
+static sort_cache result_cache(size_t(1) << 30);
+static std::vector<char> cache_col;
+static uint64_t cache_col_id = 0;
+static sort_cache::result_ptr cache_base;
+
+// Rows appended to the column in the "append" benchmark, as a fraction of N
+static constexpr int CACHE_APPEND_FRACTION = 100;
+
+template <typename T>
+static void prepare_cache_column(int n, int K, int seed) {
+  cache_col.resize(n * sizeof(T));
+  T* x = reinterpret_cast<T*>(cache_col.data());
+  generate_data<T>(x, n, K, data_dist, seed);
+  // New data in the same buffer is a new column, with an id of its own
+  cache_col_id = new_column_id();
+  result_cache.clear();
+  cache_base = cached_sort<T>(result_cache, cache_col_id, x,
+                              n - n / CACHE_APPEND_FRACTION, K, 0);
+  tmp1.ensure_size(n * sizeof(T));
+}
+
+// Every sort is a miss
+template <typename T>
+static void cache_miss_bench(T*, int*, int n, int K) {
+  result_cache.clear();
+  cached_sort<T>(result_cache, cache_col_id,
+                 reinterpret_cast<T*>(cache_col.data()), n, K, 0);
+}
+
+// The column is unchanged since the last sort
+template <typename T>
+static void cache_hit_bench(T*, int*, int n, int K) {
+  cached_sort<T>(result_cache, cache_col_id,
+                 reinterpret_cast<T*>(cache_col.data()), n, K, 0);
+}
+
+// N/CACHE_APPEND_FRACTION rows were appended since the last sort
+template <typename T>
+static void cache_append_bench(T*, int*, int n, int K) {
+  const T* x = reinterpret_cast<T*>(cache_col.data());
+  result_cache.insert(sort_cache_key{cache_col_id, 0, sizeof(T), K},
+                      cache_base);
+  cached_sort<T>(result_cache, cache_col_id, x, n, K, 0);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Compressed columns
+//------------------------------------------------------------------------------
+
+// Inputs of the compressed sort benchmarks: the keys bit-packed into K bits,
+// and the same number of rows as runs of random values.
+static std::vector<uint32_t> packed_buf;
+static packed_column packed_in;
+static std::vector<uint32_t> rle_values;
+static std::vector<int> rle_lengths;
+static rle_column rle_in;
+
+static void prepare_packed(int n, int K, int seed) {
+  std::vector<uint32_t> x(n);
+  generate_data<uint32_t>(x.data(), n, K, data_dist, seed);
+  packed_buf.resize(packed_words(n, K));
+  pack_bits(x.data(), n, K, packed_buf.data());
+  packed_in = { packed_buf.data(), n, K };
+}
+
+// Run lengths are uniform in [1, 2*mean - 1]
+static void prepare_rle(int n, int K, int mean, int seed) {
+  srand(seed);
+  rle_values.clear();
+  rle_lengths.clear();
+  uint32_t mask = static_cast<uint32_t>((uint64_t(1) << K) - 1);
+  for (int rows = 0; rows < n; ) {
+    int len = std::min(n - rows, 1 + rand() % (2 * mean - 1));
+    rle_values.push_back((static_cast<uint32_t>(rand()) * 2654435761u) & mask);
+    rle_lengths.push_back(len);
+    rows += len;
+  }
+  rle_in = { rle_values.data(), rle_lengths.data(),
+             static_cast<int>(rle_values.size()) };
+}
+
+static void packed_fused_bench(uint32_t* x, int* o, int, int) {
+  packed_sort(packed_in, x, o);
+}
+
+static void rle_fused_bench(uint32_t* x, int* o, int, int K) {
+  rle_sort(rle_in, K, x, o);
+}
+
+// Baselines: decode the column into x, then sort it with the same LSD radix
+// sort (payload_sort without payload columns)
+static void packed_decode_bench(uint32_t* x, int* o, int n, int K) {
+  unpack_bits(packed_in, x);
+  for (int i = 0; i < n; i++) o[i] = i;
+  payload_sort<uint32_t>(x, o, n, K, nullptr, 0);
+}
+
+static void rle_decode_bench(uint32_t* x, int* o, int n, int K) {
+  rle_decode(rle_in, x);
+  for (int i = 0; i < n; i++) o[i] = i;
+  payload_sort<uint32_t>(x, o, n, K, nullptr, 0);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Payload sort
+//------------------------------------------------------------------------------
+
+// Payload columns of the "carry" and "gather" benchmarks: `payload_in` are
+// the columns in the original order, `payload_out` receive the gathered rows.
+static std::vector<char> payload_src;
+static std::vector<char> payload_dst;
+static payload_col payload_in[MAX_PAYLOAD_COLS];
+static payload_col payload_out[MAX_PAYLOAD_COLS];
+static int payload_ncols = 0;
+
+// One payload column for each of the `widths` (in bytes). The columns are
+// stored one after another, each starting at a multiple of 8 bytes.
+static void prepare_payload(int n, const std::vector<int>& widths) {
+  int ncols = static_cast<int>(widths.size());
+  std::vector<size_t> offsets(ncols + 1, 0);
+  for (int c = 0; c < ncols; c++) {
+    size_t colsize = static_cast<size_t>(n) * widths[c];
+    offsets[c + 1] = offsets[c] + ((colsize + 7) & ~size_t(7));
+  }
+  payload_src.resize(offsets[ncols]);
+  payload_dst.resize(offsets[ncols]);
+  for (size_t i = 0; i < payload_src.size(); i++) {
+    payload_src[i] = static_cast<char>(i * 7);
+  }
+  for (int c = 0; c < ncols; c++) {
+    payload_in[c] = { payload_src.data() + offsets[c], widths[c] };
+    payload_out[c] = { payload_dst.data() + offsets[c], widths[c] };
+  }
+  payload_ncols = ncols;
+  tmp3.ensure_size(payload_scratch_size(n, payload_in, ncols));
+}
+
+template <typename T>
+static void payload_carry_bench(T* x, int* o, int n, int K) {
+  payload_sort<T>(x, o, n, K, payload_in, payload_ncols);
+}
+
+template <typename T>
+static void payload_gather_bench(T* x, int* o, int n, int K) {
+  payload_sort<T>(x, o, n, K, nullptr, 0);
+  gather_cols(o, n, payload_in, payload_out, payload_ncols);
+}
+
+// Same as "gather" with the gather in a single thread, like the whole of
+// "carry": this is the variant to compare "carry" with.
+template <typename T>
+static void payload_gather1_bench(T* x, int* o, int n, int K) {
+  payload_sort<T>(x, o, n, K, nullptr, 0);
+  gather_cols(o, n, payload_in, payload_out, payload_ncols, 1);
+}
+
+
+
+//------------------------------------------------------------------------------
+// Algorithm registry
+//------------------------------------------------------------------------------
+
+// One point of the sweep: all the tests of an algorithm are run with these
+// parameters.
+struct bench_params {
+  int N;     // array size
+  int K;     // number of significant bits
+  int S;     // element size, in bytes
+  int B;     // number of batches
+  int T;     // time per test, in ms
+  int seed;
+};
+
+// Bit masks of the element sizes supported by an algorithm: the size S
+// itself is the bit.
+static constexpr int SIZES_ALL = 1 | 2 | 4 | 8;
+static constexpr int SIZES_INT = 4;
+
+// Theoretical memory traffic of one sort, in bytes per element: the bytes
+// read plus the bytes written by one pass over the data, times the number of
+// passes (see the "Memory traffic" section below).
+using traffic_fn = double (*)(const bench_params&);
+
+// A sort function for each element size (1, 2, 4 and 8 bytes), or nullptr
+// for the sizes that the kernel does not support. Combined kernels sort an
+// array of xoitem<T> instead of the separate x and o arrays.
+struct sort_kernel {
+  sortfn_t fn[4];
+  bool combined;
+  traffic_fn traffic;  // nullptr if the traffic depends on the data
+
+  static int index(int S) { return S == 1? 0 : S == 2? 1 : S == 4? 2 : 3; }
+
+  int sizes() const {
+    return (fn[0]? 1 : 0) | (fn[1]? 2 : 0) | (fn[2]? 4 : 0) | (fn[3]? 8 : 0);
+  }
+
+  sort_kernel moves(traffic_fn f) const {
+    sort_kernel k = *this;
+    k.traffic = f;
+    return k;
+  }
+};
+
+#define ALL_SIZES(f, ...) \
+  sort_kernel{{(sortfn_t) f<uint8_t, ##__VA_ARGS__>,  \
+               (sortfn_t) f<uint16_t, ##__VA_ARGS__>, \
+               (sortfn_t) f<uint32_t, ##__VA_ARGS__>, \
+               (sortfn_t) f<uint64_t, ##__VA_ARGS__>}, false, nullptr}
+#define ALL_SIZES_COMBINED(f) \
+  sort_kernel{{(sortfn_t) f<uint8_t>, (sortfn_t) f<uint16_t>, \
+               (sortfn_t) f<uint32_t>, (sortfn_t) f<uint64_t>}, true, nullptr}
+#define INT_ONLY(f) \
+  sort_kernel{{nullptr, nullptr, (sortfn_t) f, nullptr}, false, nullptr}
+
+
+static std::string strfmt(const char* fmt, ...) {
+  char buf[100];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return std::string(buf);
+}
+
+template <int S>
+static void run_test(const std::string& name, sortfn_t fn, bool combined,
+                     double bytes, const bench_params& p)
+{
+  if (combined) test<S, true>(name.c_str(), fn, p.N, p.K, p.B, p.T, p.seed, bytes);
+  else          test<S>(name.c_str(), fn, p.N, p.K, p.B, p.T, p.seed, bytes);
+}
+
+// Run the test of kernel `k` for the element size p.S, if the kernel
+// supports that size.
+static void run_kernel(const std::string& name, const sort_kernel& k,
+                       const bench_params& p)
+{
+  sortfn_t fn = k.fn[sort_kernel::index(p.S)];
+  if (!fn) return;
+  double bytes = k.traffic? k.traffic(p) : 0;
+  switch (p.S) {
+    case 1: run_test<1>(name, fn, k.combined, bytes, p); break;
+    case 2: run_test<2>(name, fn, k.combined, bytes, p); break;
+    case 4: run_test<4>(name, fn, k.combined, bytes, p); break;
+    case 8: run_test<8>(name, fn, k.combined, bytes, p); break;
+  }
+}
+
+
+struct algorithm {
+  int id;          // value of the --algo option
+  const char* name;
+  int sizes;       // element sizes that the algorithm supports
+  std::function<void(const bench_params&)> run;
+};
+
+static std::vector<algorithm>& algorithms() {
+  static std::vector<algorithm> registry;
+  return registry;
+}
+
+static const algorithm* find_algorithm(int id) {
+  for (const algorithm& a : algorithms()) {
+    if (a.id == id) return &a;
+  }
+  return nullptr;
+}
+
+// Adds an algorithm into the registry when constructed (see REGISTER_ALGO).
+struct register_algorithm {
+  // An algorithm that runs its tests itself, via run_kernel()
+  register_algorithm(int id, const char* name, int sizes,
+                     std::function<void(const bench_params&)> run)
+  {
+    algorithms().push_back(algorithm{id, name, sizes, std::move(run)});
+  }
+
+  // An algorithm consisting of a single kernel, tested whenever `applies`
+  // returns true. Its results are named "S:name", or just "name" if the
+  // kernel supports only one element size.
+  register_algorithm(int id, const char* name, sort_kernel k,
+                     bool (*applies)(const bench_params&) = nullptr)
+  {
+    int sizes = k.sizes();
+    bool single = (sizes & (sizes - 1)) == 0;
+    algorithms().push_back(algorithm{id, name, sizes,
+      [=](const bench_params& p) {
+        if (applies && !applies(p)) return;
+        run_kernel(single? std::string(name) : strfmt("%d:%s", p.S, name),
+                   k, p);
+      }});
+  }
+};
+
+#define REGISTER_ALGO(id, ...) \
+  static register_algorithm algo_##id(id, __VA_ARGS__)
+
+static bool small_n(const bench_params& p) { return p.N <= 1024; }
+
+
+
+//------------------------------------------------------------------------------
+// Memory traffic
+//------------------------------------------------------------------------------
+// The traffic is the minimum a kernel of its kind has to move: each pass
+// counts every byte it reads and writes once, as if nothing stayed in the
+// caches between passes. Comparing the achieved bandwidth with the copy and
+// scatter peaks then shows whether a kernel is bound by the bandwidth (close
+// to the peak of its access pattern) or by latency (far below it).
+
+// One pass that reads and writes both x and o
+static double xo_pass(const bench_params& p) {
+  return 2.0 * (p.S + sizeof(int));
+}
+
+// Number of merge levels needed to sort n elements starting from runs of
+// `run` elements.
+static double merge_levels(int n, int run) {
+  return std::max(1.0, std::ceil(std::log2(static_cast<double>(n) / run)));
+}
+
+// Insertion sorts: a single pass over data that stays in the cache
+static double one_pass(const bench_params& p) {
+  return xo_pass(p);
+}
+
+// Top-down merge sort: insertion sorts of P elements, then the merge levels
+template <int P>
+static double merge_traffic(const bench_params& p) {
+  return xo_pass(p) * (1 + merge_levels(p.N, P));
+}
+
+static double comparison_traffic(const bench_params& p) {
+  return xo_pass(p) * merge_levels(p.N, 1);
+}
+
+// std::sort of xoitem<T>: log2(N) partitioning levels over the combined array
+static double combined_traffic(const bench_params& p) {
+  double item = p.S == 8? sizeof(xoitem<uint64_t>) : sizeof(xoitem<uint32_t>);
+  return 2 * item * merge_levels(p.N, 1);
+}
+
+// In-place quick sort: each partitioning level reads and writes the whole
+// range once, down to the insertion sorts of ~16 elements.
+static double quick_traffic(const bench_params& p) {
+  return xo_pass(p) * merge_levels(p.N, 16);
+}
+
+static double quick_keys_traffic(const bench_params& p) {
+  return 2.0 * p.S * merge_levels(p.N, 16);
+}
+
+// Counting sort: the histogram reads x; the scatter reads x and o and writes
+// the new o, which is then copied back.
+static double count_traffic(const bench_params& p) {
+  return p.S + (p.S + 2.0 * sizeof(int)) + 2.0 * sizeof(int);
+}
+
+// MSD radix sort with `radix_bits` in the first pass: each pass reads x for
+// the histogram, scatters x and o, and copies o back at the end. Buckets
+// with more than 16 bits left take another pass (radix4 only); the leaf
+// sorts make one more pass over the cache-resident buckets.
+static double radix_traffic(const bench_params& p) {
+  int passes = 1;
+  for (int rest = p.K - radix_bits; rest > 16; rest -= radix_bits) passes++;
+  return passes * (p.S + xo_pass(p) + 2.0 * sizeof(int)) + xo_pass(p);
+}
+
+// LSD radix sort with up to 11 bits per pass (see payload_sort.cc): one read
+// of x for all the histograms, then every pass moves x, o and `row` bytes of
+// payload.
+static double payload_sort_traffic(const bench_params& p, int row) {
+  int npasses = (p.K + 10) / 11;
+  return p.S + npasses * 2.0 * (p.S + sizeof(int) + row);
+}
+
+static int payload_row() {
+  int row = 0;
+  for (int c = 0; c < payload_ncols; c++) row += payload_in[c].elemsize;
+  return row;
+}
+
+static double carry_traffic(const bench_params& p) {
+  return payload_sort_traffic(p, payload_row());
+}
+
+// The keys are sorted alone, then the columns are gathered: the gather reads
+// o, and reads and writes each row.
+static double gather_traffic(const bench_params& p) {
+  return payload_sort_traffic(p, 0) + sizeof(int) + 2.0 * payload_row();
+}
+
+
+
+//------------------------------------------------------------------------------
+// Algorithms
+//------------------------------------------------------------------------------
+
+REGISTER_ALGO(1, "insert0", ALL_SIZES(insert_sort0).moves(one_pass), small_n);
+REGISTER_ALGO(2, "insert2", ALL_SIZES(insert_sort2).moves(one_pass), small_n);
+REGISTER_ALGO(3, "insert3", ALL_SIZES(insert_sort3).moves(one_pass), small_n);
+
+REGISTER_ALGO(4, "mergeTD", SIZES_ALL, [](const bench_params& p) {
+  static const sort_kernel kernels[] = {
+    ALL_SIZES(merge_sort0, 8).moves(merge_traffic<8>),
+    ALL_SIZES(merge_sort0, 12).moves(merge_traffic<12>),
+    ALL_SIZES(merge_sort0, 16).moves(merge_traffic<16>),
+    ALL_SIZES(merge_sort0, 20).moves(merge_traffic<20>),
+    ALL_SIZES(merge_sort0, 24).moves(merge_traffic<24>)
+  };
+  for (int i = 0; i < 5; i++) {
+    run_kernel(strfmt("%d:mergeTD#%d", p.S, 8 + 4*i), kernels[i], p);
+  }
+});
+
+REGISTER_ALGO(5, "mergeBU", INT_ONLY(mergesort1).moves(comparison_traffic),
+              [](const bench_params& p) { return p.N <= 1000000; });
+REGISTER_ALGO(6, "timsort", INT_ONLY(timsort).moves(comparison_traffic));
+REGISTER_ALGO(7, "stdsort", ALL_SIZES_COMBINED(std_sort).moves(combined_traffic));
+
+REGISTER_ALGO(8, "count", SIZES_ALL, [](const bench_params& p) {
+  if (p.K > 20) return;
+  run_kernel(strfmt("%d:count-%d", p.S, p.K), ALL_SIZES(count_sort0).moves(count_traffic), p);
+});
+
+REGISTER_ALGO(9, "radix1", SIZES_ALL, [](const bench_params& p) {
+  int kstep = p.K <= 4? 1 : p.K <= 16? 2 : 4;
+  for (int k = first_radix_bits(p.K, kstep);
+       k < p.K && k <= RADIX_MAX_BITS; k += kstep) {
+    radix_bits = k;
+    run_kernel(strfmt("radix1-%d", k), ALL_SIZES(radix_sort1_bench).moves(radix_traffic), p);
+  }
+});
+
+REGISTER_ALGO(10, "radix3", SIZES_ALL, [](const bench_params& p) {
+  int kstep = p.K <= 4? 1 : p.K <= 8? 2 : 4;
+  for (int k = first_radix_bits(p.K, kstep);
+       k < p.K && k <= RADIX_MAX_BITS; k += kstep) {
+    radix_bits = k;
+    run_kernel(strfmt("radix3-%d", k), ALL_SIZES(radix_sort3_bench).moves(radix_traffic), p);
+  }
+});
+
+REGISTER_ALGO(11, "catsort", SIZES_ALL, [](const bench_params& p) {
+  if (p.K > 20) return;
+  prepare_cat_dict(1 << p.K, p.seed);
+  run_kernel(strfmt("%d:catsort-%d", p.S, p.K),
+             ALL_SIZES(cat_sort_bench).moves(count_traffic), p);
+  run_kernel(strfmt("%d:catstr-%d", p.S, p.K), ALL_SIZES(cat_strsort_bench), p);
+});
+
+REGISTER_ALGO(12, "rank", SIZES_ALL, [](const bench_params& p) {
+  rank_inv.resize(p.N);
+  rank_iranks.resize(p.N);
+  rank_franks.resize(p.N);
+  run_kernel(strfmt("%d:rank-dense", p.S), ALL_SIZES(rank_sort_bench, RANK_DENSE), p);
+  run_kernel(strfmt("%d:rank-min", p.S), ALL_SIZES(rank_sort_bench, RANK_MIN), p);
+  run_kernel(strfmt("%d:rank-avg", p.S), ALL_SIZES(rank_sort_bench, RANK_AVERAGE), p);
+  run_kernel(strfmt("%d:prank-min", p.S), ALL_SIZES(rank_sort_parallel_bench, RANK_MIN), p);
+  // The baseline uses count sort, which needs 1<<K counters
+  if (p.K <= 20) {
+    run_kernel(strfmt("%d:rank-derive", p.S), ALL_SIZES(rank_derive_bench), p);
+  }
+});
+
+// The radix1 results are named apart from those of algo 9 (which runs the
+// same kernels), so that a sweep over both does not report them twice.
+REGISTER_ALGO(13, "radix1-vs-4", SIZES_ALL, [](const bench_params& p) {
+  int kstep = p.K <= 4? 1 : p.K <= 16? 2 : 4;
+  for (int k = first_radix_bits(p.K, kstep); k < p.K && k <= 16; k += kstep) {
+    radix_bits = k;
+    run_kernel(strfmt("radix1-%d-vs4", k), ALL_SIZES(radix_sort1_bench).moves(radix_traffic), p);
+    run_kernel(strfmt("radix4-%d", k), ALL_SIZES(radix_sort4_bench).moves(radix_traffic), p);
+  }
+});
+
+REGISTER_ALGO(14, "payload", SIZES_ALL, [](const bench_params& p) {
+  auto run = [&](const std::string& cols) {
+    run_kernel(strfmt("%d:carry-%s", p.S, cols.c_str()),
+               ALL_SIZES(payload_carry_bench).moves(carry_traffic), p);
+    run_kernel(strfmt("%d:gather1-%s", p.S, cols.c_str()),
+               ALL_SIZES(payload_gather1_bench).moves(gather_traffic), p);
+    run_kernel(strfmt("%d:gather-%s", p.S, cols.c_str()),
+               ALL_SIZES(payload_gather_bench).moves(gather_traffic), p);
+  };
+  // C columns of W bytes each
+  for (int w = 1; w <= 8; w *= 2) {
+    for (int c = 1; c <= 4; c *= 2) {
+      prepare_payload(p.N, std::vector<int>(c, w));
+      run(strfmt("%dx%d", c, w));
+    }
+  }
+  // Columns of different widths, as in a typical table
+  prepare_payload(p.N, {8, 1, 2, 4});
+  run("mixed");
+});
+REGISTER_ALGO(15, "quick", SIZES_ALL, [](const bench_params& p) {
+  run_kernel(strfmt("%d:quick", p.S),
+             ALL_SIZES(quick_sort).moves(quick_traffic), p);
+  run_kernel(strfmt("%d:quick-keys", p.S),
+             ALL_SIZES(quick_sort_keys_bench).moves(quick_keys_traffic), p);
+});
+REGISTER_ALGO(16, "segmented", SIZES_ALL, [](const bench_params& p) {
+  for (int mean : {4, 16, 100, 1000}) {
+    prepare_segments(p.N, mean, p.seed);
+    run_kernel(strfmt("%d:segsort-%d", p.S, mean),
+               ALL_SIZES(segmented_sort_bench), p);
+    // Above 24 bits the leaf sorts of radix_sort1 clear a 64K-entry histogram
+    // for every group, which makes the baseline impractically slow.
+    if (p.K >= 2 && p.K <= 24) {
+      run_kernel(strfmt("%d:segloop-%d", p.S, mean),
+                 ALL_SIZES(segmented_loop_bench), p);
+    }
+  }
+});
+
+
+REGISTER_ALGO(17, "indirect", SIZES_ALL, [](const bench_params& p) {
+  radix_bits = std::min(p.K, 8);
+  static const struct { int pct; const char* name; } views[] = {
+    {10, "f10"}, {50, "f50"}, {0, "perm"}
+  };
+  for (const auto& v : views) {
+    prepare_view(p.N, v.pct, p.S, p.seed);
+    run_kernel(strfmt("%d:radix4-gather-%s", p.S, v.name),
+               ALL_SIZES(gather_radix_bench), p);
+    run_kernel(strfmt("%d:radix4-indirect-%s", p.S, v.name),
+               ALL_SIZES(indirect_radix_bench), p);
+    run_kernel(strfmt("%d:merge-gather-%s", p.S, v.name),
+               ALL_SIZES(gather_merge_bench), p);
+    run_kernel(strfmt("%d:merge-indirect-%s", p.S, v.name),
+               ALL_SIZES(indirect_merge_bench), p);
+  }
+});
+
+REGISTER_ALGO(18, "cache", SIZES_ALL, [](const bench_params& p) {
+  switch (p.S) {
+    case 1: prepare_cache_column<uint8_t>(p.N, p.K, p.seed); break;
+    case 2: prepare_cache_column<uint16_t>(p.N, p.K, p.seed); break;
+    case 4: prepare_cache_column<uint32_t>(p.N, p.K, p.seed); break;
+    case 8: prepare_cache_column<uint64_t>(p.N, p.K, p.seed); break;
+  }
+  run_kernel(strfmt("%d:cache-miss", p.S), ALL_SIZES(cache_miss_bench), p);
+  run_kernel(strfmt("%d:cache-append", p.S), ALL_SIZES(cache_append_bench), p);
+  run_kernel(strfmt("%d:cache-hit", p.S), ALL_SIZES(cache_hit_bench), p);
+  cache_base = nullptr;
+  result_cache.clear();
+});
+
+REGISTER_ALGO(19, "compressed", SIZES_INT, [](const bench_params& p) {
+  if (p.K < 1) return;
+  prepare_packed(p.N, p.K, p.seed);
+  run_kernel(strfmt("packed-decode-%d", p.K), INT_ONLY(packed_decode_bench), p);
+  run_kernel(strfmt("packed-fused-%d", p.K), INT_ONLY(packed_fused_bench), p);
+  for (int mean : {4, 64}) {
+    prepare_rle(p.N, p.K, mean, p.seed);
+    run_kernel(strfmt("rle-decode-%d", mean), INT_ONLY(rle_decode_bench), p);
+    run_kernel(strfmt("rle-fused-%d", mean), INT_ONLY(rle_fused_bench), p);
+  }
+});
+
+
 struct config {
   std::vector<int> algos;
+  std::vector<int> dists;
+  std::vector<int> ns;
+  std::vector<int> ks;
+  std::vector<int> intsizes;
+  std::string file;
+  int cache;
+  std::string output;
   int batches;
-  int n;
-  int k;
   int time;
-  int intsize;
+  int hugepages;
+  bool roofline;
 
   config() {
     batches = 100;
-    n = 64;
-    k = 16;
     time = 1000;
-    intsize = 4;
+    hugepages = HUGE_PAGES_OFF;
+    cache = CACHE_WARM;
+    roofline = true;
   }
 
   void parse(int argc, char** argv) {
@@ -203,6 +1139,13 @@ struct config {
       {"k", 1, 0, 0},
       {"time", 1, 0, 0},
       {"intsize", 1, 0, 0},
+      {"hugepages", 1, 0, 0},
+      {"dist", 1, 0, 0},
+      {"file", 1, 0, 0},
+      {"cache", 1, 0, 0},
+      {"output", 1, 0, 0},
+      {"list", 0, 0, 0},
+      {"roofline", 1, 0, 0},
       {nullptr, 0, nullptr, 0}  // sentinel
     };
 
@@ -211,27 +1154,114 @@ struct config {
       int ret = getopt_long(argc, argv, "", longopts, &option_index);
       if (ret == -1) break;
       if (ret == 0) {
+        if (option_index == 11) {
+          list_algorithms();
+          exit(0);
+        }
         if (optarg) {
-          if (option_index == 0) algos.push_back(atol(optarg));
+          if (option_index == 0) parse_algos(optarg);
           if (option_index == 1) batches = atol(optarg);
-          if (option_index == 2) n = atol(optarg);
-          if (option_index == 3) k = atol(optarg);
+          if (option_index == 2) parse_list(optarg, ns);
+          if (option_index == 3) parse_list(optarg, ks);
           if (option_index == 4) time = atol(optarg);
-          if (option_index == 5) intsize = atol(optarg);
+          if (option_index == 5) parse_list(optarg, intsizes);
+          if (option_index == 6) {
+            // off | thp | hugetlb
+            hugepages = !strcmp(optarg, "thp")? HUGE_PAGES_THP :
+                        !strcmp(optarg, "hugetlb")? HUGE_PAGES_HUGETLB :
+                        HUGE_PAGES_OFF;
+          }
+          if (option_index == 7) parse_dists(optarg);
+          if (option_index == 8) file = optarg;
+          if (option_index == 9) {
+            // warm | cold
+            cache = !strcmp(optarg, "cold")? CACHE_COLD : CACHE_WARM;
+          }
+          if (option_index == 10) output = optarg;
+          if (option_index == 12) roofline = !!strcmp(optarg, "off");
         }
       }
     }
     if (algos.empty()) algos.push_back(1);
+    if (ns.empty()) ns.push_back(64);
+    if (ks.empty()) ks.push_back(16);
+    if (intsizes.empty()) intsizes.push_back(4);
+    for (int n : ns) {
+      if (n < 1) {
+        printf("Array size N must be positive, got %d\n", n);
+        exit(1);
+      }
+    }
+  }
+
+  static std::vector<std::string> split(const char* arg) {
+    std::vector<std::string> items;
+    std::string list(arg);
+    size_t start = 0;
+    while (start <= list.size()) {
+      size_t end = list.find(',', start);
+      if (end == std::string::npos) end = list.size();
+      items.push_back(list.substr(start, end - start));
+      start = end + 1;
+    }
+    return items;
+  }
+
+  // Comma-separated list of numbers
+  static void parse_list(const char* arg, std::vector<int>& out) {
+    for (const std::string& item : split(arg)) {
+      out.push_back(atol(item.c_str()));
+    }
+  }
+
+  // Comma-separated list of algorithm ids, or "all"
+  void parse_algos(const char* arg) {
+    for (const std::string& item : split(arg)) {
+      if (item == "all") {
+        for (const algorithm& a : algorithms()) algos.push_back(a.id);
+      } else {
+        algos.push_back(atol(item.c_str()));
+      }
+    }
+  }
+
+  // Comma-separated list of distribution names, or "all"
+  void parse_dists(const char* arg) {
+    for (const std::string& item : split(arg)) {
+      if (item == "all") {
+        for (int d = 0; d < NDISTS; d++) dists.push_back(d);
+      } else {
+        int d = dist_from_name(item.c_str());
+        if (d < 0) {
+          printf("Unknown distribution '%s'\n", item.c_str());
+          exit(1);
+        }
+        dists.push_back(d);
+      }
+    }
+  }
+
+  static void list_algorithms() {
+    std::vector<algorithm> algos = algorithms();
+    std::sort(algos.begin(), algos.end(),
+              [](const algorithm& a, const algorithm& b) { return a.id < b.id; });
+    printf("  algo  name          sizes\n");
+    for (const algorithm& a : algos) {
+      printf("  %4d  %-12s ", a.id, a.name);
+      for (int s = 1; s <= 8; s *= 2) {
+        if (a.sizes & s) printf(" %d", s);
+      }
+      printf("\n");
+    }
   }
 
-  void report() {
-    printf("\nInput parameters:\n");
-    printf("  batches = %d\n", batches);
-    printf("  n       = %d\n", n);
-    printf("  k       = %d\n", k);
-    printf("  time    = %d\n", time);
-    printf("  intsize = %d\n", intsize);
-    printf("\n");
+  static std::string join(const std::vector<int>& values) {
+    std::string out;
+    for (int v : values) {
+      if (!out.empty()) out += ',';
+      out += std::to_string(v);
+    }
+    return out;
   }
 };
 
@@ -240,159 +1270,114 @@ struct config {
 
 
 int main(int argc, char** argv) {
-  // A - which algo to run (1-11):
+  // A - which algos to run (see --list), comma-separated or "all"
   // B - number of batches, i.e. how many different datasets to try. Default
   //     is 100.
   // K - number of significant bits, i.e. each dataset will be comprised of
   //     random integers in the range [0, 1<<K)
   // N - array size
   // T - how long (in ms) to run the test for each algo, approximately.
+  // S - element size, in bytes
+  // N, K and S can be comma-separated lists: all their combinations (with
+  // K <= 8*S) are swept within the same process.
   config cfg;
   cfg.parse(argc, argv);
   int B = cfg.batches;
-  int N = cfg.n;
-  int K = cfg.k;
   int T = cfg.time;
-  int S = cfg.intsize;
   int seed = 1234; //time(NULL);
-  printf("Array size (N) = %d\n", N);
-  printf("N sig bits (K) = %d\n", K);
+  column_file colfile {};
+  if (!cfg.file.empty()) {
+    // Sort the keys from the file in place of generated data: N and S come
+    // from the file's header, and K from the largest value in the data.
+    if (!open_column_file(cfg.file.c_str(), &colfile)) exit(1);
+    input_data = colfile.data;
+    cfg.ns = {colfile.nrows};
+    cfg.intsizes = {colfile.elemsize};
+    cfg.ks = {std::max(column_sig_bits(&colfile), 1)};
+    cfg.dists.clear();
+    printf("Input file     = %s\n", cfg.file.c_str());
+  }
+  printf("Array size (N) = %s\n", config::join(cfg.ns).c_str());
+  printf("N sig bits (K) = %s\n", config::join(cfg.ks).c_str());
   printf("N batches  (B) = %d\n", B);
   printf("Exec. time (T) = %d ms\n", T);
-  printf("Elem. size (S) = %d\n", S);
+  printf("Elem. size (S) = %s\n", config::join(cfg.intsizes).c_str());
+  printf("Huge pages     = %s\n", cfg.hugepages == HUGE_PAGES_THP? "thp" :
+                                   cfg.hugepages == HUGE_PAGES_HUGETLB? "hugetlb" : "off");
+  printf("Perf counters  = %s\n", perf.available()? "on" : "unavailable");
+  printf("Cache mode     = %s\n", cfg.cache == CACHE_COLD? "cold" : "warm");
+  set_huge_pages(cfg.hugepages);
+  if (cfg.roofline) {
+    // The probe buffers are larger than the LLC (up to 256MB each), so this
+    // is the bandwidth of the main memory.
+    peak_bw = probe_bandwidth(std::min(std::max(2 * llc_size(), size_t(64) << 20),
+                                       size_t(256) << 20));
+    printf("Peak bandwidth = %.2f GB/s copy, %.2f GB/s scatter\n",
+           peak_bw.copy, peak_bw.scatter);
+  }
   printf("\n");
-  if (S != 1 && S != 2 && S != 4 && S == 8) {
-    printf("Unsupported integer size\n");
-    exit(0);
+  for (int S : cfg.intsizes) {
+    if (S != 1 && S != 2 && S != 4 && S != 8) {
+      printf("Unsupported integer size %d\n", S);
+      exit(0);
+    }
   }
-  if (S * 8 < K) {
-    printf("Number of bits %d cannot exceed integer size %d\n", K, S*8);
-    exit(0);
+  for (int A : cfg.algos) {
+    const algorithm* algo = find_algorithm(A);
+    if (!algo) {
+      printf("A = %d is not supported\n", A);
+      continue;
+    }
+    for (int S : cfg.intsizes) {
+      if (!(algo->sizes & S)) {
+        printf("A = %d (%s) does not support S = %d\n", A, algo->name, S);
+      }
+    }
   }
 
-  char name[100];
-  tmp1.ensure_size(2*N*sizeof(int));
-  tmp2.ensure_size(N*sizeof(int));
-  tmp3.ensure_size((1<<K)*sizeof(int));
+  cache_mode = cfg.cache;
+  dist_suffix = !cfg.dists.empty();
+  if (cfg.dists.empty()) cfg.dists.push_back(DIST_UNIFORM);
+  size_t npoints = cfg.ns.size() * cfg.ks.size() * cfg.intsizes.size();
 
-  for (int A : cfg.algos) {
-    switch (A) {
-      case 1:
-        if (N <= 1024) {
-          if (S == 1) test<1>("1:insert0", (sortfn_t)insert_sort0<uint8_t>,  N, K, B, T, seed);
-          if (S == 2) test<2>("2:insert0", (sortfn_t)insert_sort0<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>("4:insert0", (sortfn_t)insert_sort0<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>("8:insert0", (sortfn_t)insert_sort0<uint64_t>, N, K, B, T, seed);
-        }
-        break;
-
-      case 2:
-        if (N <= 1024) {
-          if (S == 1) test<1>("1:insert2", (sortfn_t)insert_sort2<uint8_t>,  N, K, B, T, seed);
-          if (S == 2) test<2>("2:insert2", (sortfn_t)insert_sort2<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>("4:insert2", (sortfn_t)insert_sort2<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>("8:insert2", (sortfn_t)insert_sort2<uint64_t>, N, K, B, T, seed);
-        }
-        break;
-
-      case 3:
-        if (N <= 1024) {
-          if (S == 1) test<1>("1:insert3", (sortfn_t)insert_sort3<uint8_t>,  N, K, B, T, seed);
-          if (S == 2) test<2>("2:insert3", (sortfn_t)insert_sort3<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>("4:insert3", (sortfn_t)insert_sort3<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>("8:insert3", (sortfn_t)insert_sort3<uint64_t>, N, K, B, T, seed);
-        }
-        break;
-
-      case 4:
-        if (S == 1) {
-          test<1>("1:mergeTD#8",  (sortfn_t)merge_sort0<uint8_t, 8>,  N, K, B, T, seed);
-          test<1>("1:mergeTD#12", (sortfn_t)merge_sort0<uint8_t, 12>, N, K, B, T, seed);
-          test<1>("1:mergeTD#16", (sortfn_t)merge_sort0<uint8_t, 16>, N, K, B, T, seed);
-          test<1>("1:mergeTD#20", (sortfn_t)merge_sort0<uint8_t, 20>, N, K, B, T, seed);
-          test<1>("1:mergeTD#24", (sortfn_t)merge_sort0<uint8_t, 24>, N, K, B, T, seed);
-        }
-        if (S == 2) {
-          test<2>("2:mergeTD#8",  (sortfn_t)merge_sort0<uint16_t, 8>,  N, K, B, T, seed);
-          test<2>("2:mergeTD#12", (sortfn_t)merge_sort0<uint16_t, 12>, N, K, B, T, seed);
-          test<2>("2:mergeTD#16", (sortfn_t)merge_sort0<uint16_t, 16>, N, K, B, T, seed);
-          test<2>("2:mergeTD#20", (sortfn_t)merge_sort0<uint16_t, 20>, N, K, B, T, seed);
-          test<2>("2:mergeTD#24", (sortfn_t)merge_sort0<uint16_t, 24>, N, K, B, T, seed);
-        }
-        if (S == 4) {
-          test<4>("4:mergeTD#8",  (sortfn_t)merge_sort0<uint32_t, 8>,  N, K, B, T, seed);
-          test<4>("4:mergeTD#12", (sortfn_t)merge_sort0<uint32_t, 12>, N, K, B, T, seed);
-          test<4>("4:mergeTD#16", (sortfn_t)merge_sort0<uint32_t, 16>, N, K, B, T, seed);
-          test<4>("4:mergeTD#20", (sortfn_t)merge_sort0<uint32_t, 20>, N, K, B, T, seed);
-          test<4>("4:mergeTD#24", (sortfn_t)merge_sort0<uint32_t, 24>, N, K, B, T, seed);
-        }
-        if (S == 8) {
-          test<8>("8:mergeTD#8",  (sortfn_t)merge_sort0<uint64_t, 8>,  N, K, B, T, seed);
-          test<8>("8:mergeTD#12", (sortfn_t)merge_sort0<uint64_t, 12>, N, K, B, T, seed);
-          test<8>("8:mergeTD#16", (sortfn_t)merge_sort0<uint64_t, 16>, N, K, B, T, seed);
-          test<8>("8:mergeTD#20", (sortfn_t)merge_sort0<uint64_t, 20>, N, K, B, T, seed);
-          test<8>("8:mergeTD#24", (sortfn_t)merge_sort0<uint64_t, 24>, N, K, B, T, seed);
-        }
-        break;
-
-      case 5:
-        if (N <= 1000000) {
-          test<4>("mergeBU", (sortfn_t)mergesort1, N, K, B, T, seed);
-        }
-        break;
-
-      case 6:
-        test<4>("timsort", (sortfn_t)timsort, N, K, B, T, seed);
-        break;
-
-      case 7:
-        if (S == 1) test<1, true>("1:stdsort", (sortfn_t)std_sort<uint8_t>,  N, K, B, T, seed);
-        if (S == 2) test<2, true>("2:stdsort", (sortfn_t)std_sort<uint16_t>, N, K, B, T, seed);
-        if (S == 4) test<4, true>("4:stdsort", (sortfn_t)std_sort<uint32_t>, N, K, B, T, seed);
-        if (S == 8) test<8, true>("8:stdsort", (sortfn_t)std_sort<uint64_t>, N, K, B, T, seed);
-        break;
-
-      case 8:
-        if (K <= 20) {
-          sprintf(name, "%d:count-%d", S, K);
-          if (S == 1) test<1>(name, (sortfn_t)count_sort0<uint8_t>, N, K, B, T, seed);
-          if (S == 2) test<2>(name, (sortfn_t)count_sort0<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>(name, (sortfn_t)count_sort0<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>(name, (sortfn_t)count_sort0<uint64_t>, N, K, B, T, seed);
-        }
-        break;
-
-      case 9: {
-        int kstep = K <= 4? 1 : K <= 16? 2 : 4;
-        for (int k = kstep; k < K; k += kstep) {
-          if (k > 20) continue;
-          tmp0 = k;
-          sprintf(name, "radix1-%d", k);
-          if (S == 1) test<1>(name, (sortfn_t)radix_sort1<uint8_t>,  N, K, B, T, seed);
-          if (S == 2) test<2>(name, (sortfn_t)radix_sort1<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>(name, (sortfn_t)radix_sort1<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>(name, (sortfn_t)radix_sort1<uint64_t>, N, K, B, T, seed);
-        }
+  for (int S : cfg.intsizes) {
+    for (int K : cfg.ks) {
+      if (S * 8 < K) {
+        printf("Number of bits %d cannot exceed integer size %d\n", K, S*8);
+        continue;
       }
-      break;
-
-      case 10: {
-        int kstep = K <= 4? 1 : K <= 8? 2 : 4;
-        for (int k = kstep; k < K; k += kstep) {
-          if (k > 20) continue;
-          sprintf(name, "radix3-%d", k);
-          tmp0 = k;
-          if (S == 1) test<1>(name, (sortfn_t)radix_sort3<uint8_t>,  N, K, B, T, seed);
-          if (S == 2) test<2>(name, (sortfn_t)radix_sort3<uint16_t>, N, K, B, T, seed);
-          if (S == 4) test<4>(name, (sortfn_t)radix_sort3<uint32_t>, N, K, B, T, seed);
-          if (S == 8) test<8>(name, (sortfn_t)radix_sort3<uint64_t>, N, K, B, T, seed);
+      for (int N : cfg.ns) {
+        // The scratch buffers only grow, so they are allocated once for the
+        // largest N and K of the sweep. tmp3 holds the counters of the count
+        // sorts (K <= 20), or the first-pass histogram of radix1/radix3 (at
+        // most 1<<RADIX_MAX_BITS entries) followed by the counters of their
+        // leaf sorts (at most 1<<RADIX_LEAF_BITS).
+        tmp1.ensure_size(2*N*sizeof(int));
+        tmp2.ensure_size(N*sizeof(int));
+        tmp3.ensure_size(((size_t(1) << std::min(K, RADIX_MAX_BITS)) +
+                          (size_t(1) << std::min(K, RADIX_LEAF_BITS))) * sizeof(int));
+        if (npoints > 1) {
+          printf("## N=%d K=%d S=%d\n", N, K, S);
+        }
+        bench_params params {N, K, S, B, T, seed};
+        for (int D : cfg.dists) {
+          data_dist = D;
+          for (int A : cfg.algos) {
+            const algorithm* algo = find_algorithm(A);
+            if (algo && (algo->sizes & S)) algo->run(params);
+          }
         }
       }
-      break;
-      default:
-        printf("A = %d is not supported\n", A);
     }
   }
 
+  if (!cfg.output.empty()) {
+    if (report.save(cfg.output)) {
+      printf("Results saved into %s\n", cfg.output.c_str());
+    } else {
+      printf("Unable to write file %s\n", cfg.output.c_str());
+    }
+  }
+  close_column_file(&colfile);
   return 0;
 }
@@ -0,0 +1,125 @@
+//==============================================================================
+// Allocation of large buffers, optionally backed by 2MB huge pages
+//==============================================================================
+#include <algorithm>    // std::min
+#include <cstring>      // std::memcpy
+#include <new>          // std::bad_alloc
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>   // mmap, munmap, madvise
+#include "sort.h"
+
+static constexpr size_t HUGE_PAGE_SIZE = size_t(1) << 21;
+
+// Each buffer is preceded by a header that records how it was allocated.
+// The header occupies a full cache line so that the data stays aligned.
+static constexpr size_t HEADER_SIZE = 64;
+
+// Allocations smaller than this always come from malloc.
+static constexpr size_t HUGE_PAGES_MIN = HUGE_PAGE_SIZE;
+
+struct alloc_header {
+  size_t size;     // usable size of the buffer
+  size_t maplen;   // length of the mapping, or 0 if allocated with malloc
+};
+
+static int huge_pages_mode = HUGE_PAGES_OFF;
+
+
+void set_huge_pages(int mode) {
+  huge_pages_mode = mode;
+}
+
+int get_huge_pages() {
+  return huge_pages_mode;
+}
+
+
+// Map `len` bytes (a multiple of HUGE_PAGE_SIZE) according to the current
+// huge pages mode. Explicit huge pages (MAP_HUGETLB) require a pre-reserved
+// pool, so when none are available we fall back to an ordinary mapping with
+// a transparent huge pages hint, and if that is not supported either then
+// the memory simply stays on 4KB pages.
+static void* map_pages(size_t len) {
+  #ifdef MAP_HUGETLB
+    if (huge_pages_mode == HUGE_PAGES_HUGETLB) {
+      void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) return p;
+    }
+  #endif
+  // Over-allocate so that the mapping can be trimmed to a 2MB boundary:
+  // the kernel only backs aligned 2MB ranges with transparent huge pages.
+  size_t maplen = len + HUGE_PAGE_SIZE;
+  void* p = mmap(nullptr, maplen, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return nullptr;
+  uintptr_t start = reinterpret_cast<uintptr_t>(p);
+  uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  if (aligned > start) {
+    munmap(p, aligned - start);
+  }
+  uintptr_t end = aligned + len;
+  if (start + maplen > end) {
+    munmap(reinterpret_cast<void*>(end), start + maplen - end);
+  }
+  #ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE);
+  #endif
+  return reinterpret_cast<void*>(aligned);
+}
+
+
+void* large_alloc(size_t sz) {
+  size_t total = sz + HEADER_SIZE;
+  char* base = nullptr;
+  size_t maplen = 0;
+  if (huge_pages_mode != HUGE_PAGES_OFF && total >= HUGE_PAGES_MIN) {
+    maplen = (total + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    base = static_cast<char*>(map_pages(maplen));
+    if (!base) maplen = 0;
+  }
+  if (!base) {
+    base = static_cast<char*>(malloc(total));
+    if (!base) throw std::bad_alloc();
+  }
+  alloc_header* header = reinterpret_cast<alloc_header*>(base);
+  header->size = sz;
+  header->maplen = maplen;
+  return base + HEADER_SIZE;
+}
+
+
+void large_free(void* ptr) {
+  if (!ptr) return;
+  char* base = static_cast<char*>(ptr) - HEADER_SIZE;
+  alloc_header* header = reinterpret_cast<alloc_header*>(base);
+  if (header->maplen) {
+    munmap(base, header->maplen);
+  } else {
+    free(base);
+  }
+}
+
+
+void* large_realloc(void* ptr, size_t sz) {
+  if (!ptr) return large_alloc(sz);
+  char* base = static_cast<char*>(ptr) - HEADER_SIZE;
+  alloc_header* header = reinterpret_cast<alloc_header*>(base);
+  if (header->maplen == 0 &&
+      (huge_pages_mode == HUGE_PAGES_OFF || sz + HEADER_SIZE < HUGE_PAGES_MIN))
+  {
+    base = static_cast<char*>(realloc(base, sz + HEADER_SIZE));
+    if (!base) throw std::bad_alloc();
+    reinterpret_cast<alloc_header*>(base)->size = sz;
+    return base + HEADER_SIZE;
+  }
+  if (sz + HEADER_SIZE <= header->maplen) {
+    header->size = sz;
+    return ptr;
+  }
+  void* res = large_alloc(sz);
+  std::memcpy(res, ptr, std::min(sz, header->size));
+  large_free(ptr);
+  return res;
+}
@@ -43,21 +43,12 @@ static int compute_minrun(int n)
 
 
 
-// Top-down mergesort
+// Merge the sorted runs x[0..n1) and x[n1..n1+n2) (with their o's) in place.
+// The first run is moved out of the way into `t` / `u`, so those need room
+// for n1 elements.
 template <typename T>
-void mergesort0_impl(T* x, int* o, int n, T* t, int* u, int P)
+static void merge_runs(T* x, int* o, int n1, int n2, T* t, int* u)
 {
-  if (n <= P) {
-    insert_sort0<T>(x, o, n, 0);
-    return;
-  }
-  // Sort each part recursively
-  int n1 = n / 2;
-  int n2 = n - n1;
-  mergesort0_impl<T>(x, o, n1, t, u, P);
-  mergesort0_impl<T>(x + n1, o + n1, n2, t + n1, u + n1, P);
-
-  // Merge the parts
   std::memcpy(t, x, n1 * sizeof(T));
   std::memcpy(u, o, n1 * sizeof(int));
   int i = 0, j = 0, k = 0;
@@ -79,7 +70,7 @@ void mergesort0_impl(T* x, int* o, int n, T* t, int* u, int P)
       o[k] = o2[j];
       k++; j++;
       if (j == n2) {
-        memcpy(x + k, x1 + i, (n1 - i) * sizeof(int));
+        memcpy(x + k, x1 + i, (n1 - i) * sizeof(T));
         memcpy(o + k, o1 + i, (n1 - i) * sizeof(int));
         break;
       }
@@ -87,6 +78,25 @@ void mergesort0_impl(T* x, int* o, int n, T* t, int* u, int P)
   }
 }
 
+
+// Top-down mergesort
+template <typename T>
+void mergesort0_impl(T* x, int* o, int n, T* t, int* u, int P)
+{
+  if (n <= P) {
+    insert_sort0<T>(x, o, n, 0);
+    return;
+  }
+  // Sort each part recursively
+  int n1 = n / 2;
+  int n2 = n - n1;
+  mergesort0_impl<T>(x, o, n1, t, u, P);
+  mergesort0_impl<T>(x + n1, o + n1, n2, t + n1, u + n1, P);
+
+  // Merge the parts
+  merge_runs<T>(x, o, n1, n2, t, u);
+}
+
 // P - size below which the sort function falls back to insert sort
 template <typename T, int P>
 void merge_sort0(T* x, int* o, int n, int K) {
@@ -118,6 +128,52 @@ template void merge_sort0<uint64_t, 24>(uint64_t*, int*, int, int);
 
 
 
+// Top-down mergesort of the keys src[o[i]]: the leaves gather their keys into
+// `x` right before their insertion sorts, so the keys are read through `o`
+// only once, and every merge level runs over the contiguous copy. Both
+// halves share the merge scratch `t` / `u`, which needs room for n/2
+// elements: it is only used after the halves are sorted.
+template <typename T>
+static void mergesort0_indirect_impl(const T* src, T* x, int* o, int n,
+                                     T* t, int* u, int P, const int* oend)
+{
+  if (n <= P) {
+    for (int i = 0; i < n; i++) {
+      if (o + i + INDIRECT_PREFETCH_DISTANCE < oend) {
+        __builtin_prefetch(src + o[i + INDIRECT_PREFETCH_DISTANCE]);
+      }
+      x[i] = src[o[i]];
+    }
+    insert_sort0<T>(x, o, n, 0);
+    return;
+  }
+  int n1 = n / 2;
+  int n2 = n - n1;
+  mergesort0_indirect_impl<T>(src, x, o, n1, t, u, P, oend);
+  mergesort0_indirect_impl<T>(src, x + n1, o + n1, n2, t, u, P, oend);
+  merge_runs<T>(x, o, n1, n2, t, u);
+}
+
+// Indirect version of merge_sort0: sorts the row indices `o` by the keys
+// x[o[i]], without gathering the keys first.
+// Uses:
+//   tmp1 - n + n/2 elements of type T: the sorted keys, and merge scratch
+//   tmp2 - n/2 ints
+template <typename T, int P>
+void merge_sort0_indirect(const T* x, int* o, int n, int K) {
+  assert(tmp1.size() >= (n + n / 2) * sizeof(T));
+  assert(tmp2.size() >= (n / 2) * sizeof(int));
+  T* xx = tmp1.get<T>();
+  mergesort0_indirect_impl<T>(x, xx, o, n, xx + n, tmp2.get<int>(), P, o + n);
+}
+
+template void merge_sort0_indirect<uint8_t,  16>(const uint8_t*,  int*, int, int);
+template void merge_sort0_indirect<uint16_t, 16>(const uint16_t*, int*, int, int);
+template void merge_sort0_indirect<uint32_t, 16>(const uint32_t*, int*, int, int);
+template void merge_sort0_indirect<uint64_t, 16>(const uint64_t*, int*, int, int);
+
+
+
 
 //==============================================================================
 // Bottom-up merge sort
@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+# Convert a text column of non-negative integers (one value per line, e.g. a
+# CSV column dumped with `cut`) into the binary column file that
+# `./sort --file=...` memory-maps. The element size is the smallest of
+# 1, 2, 4 or 8 bytes that fits the largest value, unless given explicitly.
+import array
+import struct
+import sys
+
+TYPECODES = {1: "B", 2: "H", 4: "I", 8: "Q"}
+
+if len(sys.argv) < 3:
+    print("Usage:")
+    print("    python mkcol.py INPUT.txt OUTPUT.col [ELEMSIZE]")
+    print("where INPUT.txt can be '-' to read from stdin")
+    exit(0)
+
+src = sys.stdin if sys.argv[1] == "-" else open(sys.argv[1])
+values = [int(line) for line in src if line.strip()]
+maxval = max(values) if values else 0
+if len(sys.argv) > 3:
+    elemsize = int(sys.argv[3])
+else:
+    elemsize = next(s for s in (1, 2, 4, 8) if maxval < (1 << (8 * s)))
+
+data = array.array(TYPECODES[elemsize], values)
+if sys.byteorder != "little":
+    data.byteswap()
+with open(sys.argv[2], "wb") as out:
+    out.write(struct.pack("<4sIQ", b"SCOL", elemsize, len(values)))
+    data.tofile(out)
+print("Wrote %d values of %d bytes to %s" % (len(values), elemsize, sys.argv[2]))
@@ -6,17 +6,47 @@ import colorama
 
 NMIN = 45
 
-def get_cmd(n):
-    return [c.replace("{N}", str(n)).replace("--n={N}", "--n=" + str(n))
-            for c in sys.argv[1:]]
+def get_cmd(ns):
+    nlist = ",".join(str(n) for n in ns)
+    return [c.replace("{N}", nlist) for c in sys.argv[1:]]
+
+def print_row(label, headers, values):
+    global headers_printed
+    if headers_printed:
+        if headers != headers_printed:
+            values = [values[headers.index(h)] if h in headers else None
+                      for h in headers_printed]
+    else:
+        headers_printed = list(headers)
+        divider = "+".join(["-" * 10] + ["-" * 14] * len(headers))
+        print(divider)
+        print(" n" + " " * 8, end="")
+        for h in headers:
+            print("| %12s " % h, end="")
+        print()
+        print(divider)
+    print(" %-8s " % label, end="")
+    known = [v for v in values if v is not None]
+    minval = min(known) if known else 0
+    for v in values:
+        if v is None:
+            print("|" + " " * 14, end="")
+        elif v <= minval * 1.25:
+            # highlight green values not too far away from min
+            print("|\x1B[32m %12s \x1B[m" % v, end="")
+        else:
+            print("| %12s " % v, end="")
+    print()
+    sys.stdout.flush()
 
 try:
-    if len(sys.argv) > 2 and ("{N}" in sys.argv or "--n={N}" in sys.argv):
-        print("Command example: %s" % " ".join(get_cmd(42)))
+    if len(sys.argv) > 2 and any("{N}" in c for c in sys.argv):
+        print("Command example: %s" % " ".join(get_cmd([42, 64])))
     else:
         print("Usage:")
-        print("    python munch.py ./sort --n {N} ...")
-        print("where ... indicates pass-through parameters\n")
+        print("    python munch.py ./sort --n={N} ...")
+        print("where ... indicates pass-through parameters. All sizes are")
+        print("swept within a single run of the program.\n")
         exit(0)
 
     colorama.init()
@@ -25,53 +55,31 @@ try:
           [100, 128, 160, 196, 256, 512, 1024])
     ns += [1 << i for i in range(11, 28)]
     ns += [3 << i for i in range(7, 27)]
-    ns.sort()
+    ns = sorted(n for n in ns if n >= NMIN)
 
-    for n in ns:
-        if n < NMIN:
+    # The program prints a "## N=... K=... S=..." line before the results
+    # for each point of the sweep; each point becomes a row of the table.
+    proc = subprocess.Popen(get_cmd(ns), stdout=subprocess.PIPE,
+                            universal_newlines=True)
+    label = None
+    headers = []
+    values = []
+    for line in proc.stdout:
+        mm = re.match(r"^## N=(\d+) K=(\d+) S=(\d+)", line)
+        if mm:
+            if label and headers:
+                print_row(label, headers, values)
+            label = mm.group(1)
+            headers = []
+            values = []
             continue
-        cmd = get_cmd(n)
-        try:
-            out = subprocess.check_output(cmd).decode()
-        except subprocess.CalledProcessError as e:
-            print(" %-8d | %s" % (n, e))
-            continue
-        headers = []
-        values = []
-        for line in out.split("\n"):
-            mm = re.search(r"^\[\s*([\w\-/:#@]+)\]\s*([\d\.]+)", line)
-            if mm:
-                name = mm.group(1)
-                value = mm.group(2)
-                headers.append(name)
-                if value == "-":
-                    values.append(None)
-                else:
-                    v = float(value)
-                    values.append(int(v*10 + 0.5)/10)
-        if headers_printed:
-            if headers != headers_printed:
-                values = [values[headers.index(h)] if h in headers else None
-                          for h in headers_printed]
-        else:
-            headers_printed = list(headers)
-            divider = "+".join(["-" * 10] + ["-" * 14] * len(headers))
-            print(divider)
-            print(" n" + " " * 8, end="")
-            for h in headers:
-                print("| %12s " % h, end="")
-            print()
-            print(divider)
-        print(" %-8d " % n, end="")
-        minval = min(v for v in values if v is not None)
-        for v in values:
-            if v is None:
-                print("|" + " " * 14, end="")
-            elif v <= minval * 1.25:
-                # highlight green values not too far away from min
-                print("|\x1B[32m %12s \x1B[m" % v, end="")
-            else:
-                print("| %12s " % v, end="")
-        print()
+        mm = re.search(r"^\[\s*([\w\-/:#@]+)\]\s*([\d\.]+)", line)
+        if mm:
+            headers.append(mm.group(1))
+            values.append(int(float(mm.group(2))*10 + 0.5)/10)
+    if label and headers:
+        print_row(label, headers, values)
+    if proc.wait() != 0:
+        print("Process exited with code %d" % proc.returncode)
 except KeyboardInterrupt:
     print("\r\x1B[33m-- Stopped.\x1B[m")
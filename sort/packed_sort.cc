@@ -0,0 +1,266 @@
+//==============================================================================
+// Sorting compressed (bit-packed and run-length encoded) columns
+//==============================================================================
+#include <array>        // std::array
+#include <cstring>      // std::memset, std::memcpy
+#include <utility>      // std::integer_sequence, std::swap
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+#include "sort.h"
+
+// Maximum number of bits processed by a single LSD radix pass.
+static constexpr int PACKED_RADIX_BITS = 11;
+
+// Enough passes to cover a 32-bit key.
+static constexpr int PACKED_MAX_PASSES = 3;
+
+
+
+//------------------------------------------------------------------------------
+// Bit packing
+//------------------------------------------------------------------------------
+
+size_t packed_words(int n, int width) {
+  size_t nblocks = (static_cast<size_t>(n) + PACK_BLOCK - 1) / PACK_BLOCK;
+  return nblocks * width + 1;
+}
+
+
+void pack_bits(const uint32_t* x, int n, int width, uint32_t* words) {
+  assert(width >= 1 && width <= 32);
+  std::memset(words, 0, packed_words(n, width) * sizeof(uint32_t));
+  for (int i = 0; i < n; i++) {
+    uint64_t bit = static_cast<uint64_t>(i) * width;
+    uint64_t v = x[i] & ((uint64_t(1) << width) - 1);
+    uint64_t w;
+    std::memcpy(&w, words + (bit >> 5), sizeof(w));
+    w |= v << (bit & 31);
+    std::memcpy(words + (bit >> 5), &w, sizeof(w));
+  }
+}
+
+
+// Unpack one block of PACK_BLOCK values of W bits, which start at `in`. Each
+// value is extracted from an unaligned 64-bit load; with W known at compile
+// time the loop is fully unrolled into independent shift-and-mask
+// operations, which the compiler can vectorize.
+template <int W>
+static void unpack_block(const uint32_t* in, uint32_t* out) {
+  constexpr uint64_t MASK = (uint64_t(1) << W) - 1;
+  for (int j = 0; j < PACK_BLOCK; j++) {
+    int bit = j * W;
+    uint64_t w;
+    std::memcpy(&w, in + (bit >> 5), sizeof(w));
+    out[j] = static_cast<uint32_t>((w >> (bit & 31)) & MASK);
+  }
+}
+
+using unpack_fn_t = void(*)(const uint32_t*, uint32_t*);
+
+template <int... I>
+static constexpr std::array<unpack_fn_t, sizeof...(I)>
+make_unpack_table(std::integer_sequence<int, I...>) {
+  return {{ unpack_block<I + 1>... }};
+}
+
+static constexpr std::array<unpack_fn_t, 32> unpack_table =
+    make_unpack_table(std::make_integer_sequence<int, 32>());
+
+
+// Call `f(i, v)` for every value of the packed column, in order. The values
+// are decoded one block at a time into a buffer on the stack.
+template <typename F>
+static void for_each_packed(const packed_column& col, F f) {
+  assert(col.width >= 1 && col.width <= 32);
+  unpack_fn_t unpack = unpack_table[col.width - 1];
+  uint32_t buf[PACK_BLOCK];
+  const uint32_t* in = col.words;
+  for (int i0 = 0; i0 < col.n; i0 += PACK_BLOCK, in += col.width) {
+    unpack(in, buf);
+    int m = col.n - i0 < PACK_BLOCK? col.n - i0 : PACK_BLOCK;
+    for (int j = 0; j < m; j++) f(i0 + j, buf[j]);
+  }
+}
+
+
+void unpack_bits(const packed_column& col, uint32_t* x) {
+  for_each_packed(col, [=](int i, uint32_t v) { x[i] = v; });
+}
+
+
+
+//------------------------------------------------------------------------------
+// Packed sort
+//------------------------------------------------------------------------------
+
+// Turn the histogram `h` into the bucket start offsets. Returns false if all
+// `n` elements fall into the same bucket (the pass can be skipped).
+static bool histogram_to_offsets(int* h, int nradixes, int n) {
+  int cumsum = 0;
+  for (int r = 0; r < nradixes; r++) {
+    int t = h[r];
+    if (t == n) return false;
+    h[r] = cumsum;
+    cumsum += t;
+  }
+  return true;
+}
+
+
+// Stable LSD radix sort of a bit-packed column, with the decoding fused into
+// the sort: the histograms of all passes are computed while decoding the
+// column block by block, and the first scatter decodes it once more (the
+// packed data is `width/32` the size of the decoded keys). The decoded keys
+// are first written by that scatter, already in the order of the first
+// digit, so no decoded copy of the column in its original order is ever
+// made. On return `x` and `o` hold the sorted keys and their row numbers.
+// tmp1 and tmp2 should have at least `n` elements of uint32_t / int.
+void packed_sort(const packed_column& col, uint32_t* x, int* o)
+{
+  int n = col.n;
+  int K = col.width;
+  assert(tmp1.size() >= n * sizeof(uint32_t));
+  assert(tmp2.size() >= n * sizeof(int));
+  int npasses = (K + PACKED_RADIX_BITS - 1) / PACKED_RADIX_BITS;
+  int nbits = (K + npasses - 1) / npasses;
+  int nradixes = 1 << nbits;
+  uint32_t mask = static_cast<uint32_t>(nradixes - 1);
+
+  int histograms[PACKED_MAX_PASSES][1 << PACKED_RADIX_BITS];
+  std::memset(histograms, 0, sizeof(histograms));
+  for_each_packed(col, [&](int, uint32_t v) {
+    for (int p = 0; p < npasses; p++) {
+      histograms[p][(v >> (p * nbits)) & mask]++;
+    }
+  });
+
+  // The first scatter goes into x/o directly if it is the only pass with any
+  // work left, and into tmp1/tmp2 otherwise.
+  bool todo[PACKED_MAX_PASSES];
+  int nlater = 0;
+  for (int p = 0; p < npasses; p++) {
+    todo[p] = histogram_to_offsets(histograms[p], nradixes, n);
+    if (p) nlater += todo[p];
+  }
+  uint32_t* xsrc = nlater % 2? tmp1.get<uint32_t>() : x;
+  int*      osrc = nlater % 2? tmp2.get<int>() : o;
+  uint32_t* xdst = nlater % 2? x : tmp1.get<uint32_t>();
+  int*      odst = nlater % 2? o : tmp2.get<int>();
+  int* h0 = histograms[0];
+  if (todo[0]) {
+    for_each_packed(col, [=](int i, uint32_t v) {
+      int k = h0[v & mask]++;
+      xsrc[k] = v;
+      osrc[k] = i;
+    });
+  } else {
+    for_each_packed(col, [=](int i, uint32_t v) {
+      xsrc[i] = v;
+      osrc[i] = i;
+    });
+  }
+
+  for (int p = 1; p < npasses; p++) {
+    if (!todo[p]) continue;
+    int* h = histograms[p];
+    int shift = p * nbits;
+    for (int i = 0; i < n; i++) {
+      uint32_t v = xsrc[i];
+      int k = h[(v >> shift) & mask]++;
+      xdst[k] = v;
+      odst[k] = osrc[i];
+    }
+    std::swap(xsrc, xdst);
+    std::swap(osrc, odst);
+  }
+  assert(xsrc == x && osrc == o);
+}
+
+
+
+//------------------------------------------------------------------------------
+// RLE sort
+//------------------------------------------------------------------------------
+
+void rle_decode(const rle_column& col, uint32_t* x) {
+  for (int r = 0; r < col.nruns; r++) {
+    uint32_t v = col.values[r];
+    for (int j = 0; j < col.lengths[r]; j++) *x++ = v;
+  }
+}
+
+
+// Stable sort of a run-length encoded column, which works on the runs rather
+// than on the rows: all the passes but the last one are an LSD radix sort of
+// the runs. In the last pass every run becomes a single entry of the
+// histogram, weighted by its length, and the scatter writes out the rows of
+// each run as a whole. The cost is proportional to the number of runs, plus
+// one write of each of the `n` output rows.
+// On return `x` and `o` hold the sorted keys and their row numbers.
+void rle_sort(const rle_column& col, int K, uint32_t* x, int* o)
+{
+  int nruns = col.nruns;
+  if (nruns == 0) return;
+  int npasses = K? (K + PACKED_RADIX_BITS - 1) / PACKED_RADIX_BITS : 1;
+  int nbits = K? (K + npasses - 1) / npasses : 1;
+  int nradixes = 1 << nbits;
+  uint32_t mask = static_cast<uint32_t>(nradixes - 1);
+  int last = npasses - 1;
+
+  // Run starts, and the ping-pong arrays of the run values and run indices
+  std::vector<int> starts(nruns);
+  std::vector<uint32_t> rv(col.values, col.values + nruns), rv2(nruns);
+  std::vector<int> ri(nruns), ri2(nruns);
+  int n = 0;
+  for (int r = 0; r < nruns; r++) {
+    starts[r] = n;
+    n += col.lengths[r];
+    ri[r] = r;
+  }
+
+  int histograms[PACKED_MAX_PASSES][1 << PACKED_RADIX_BITS];
+  std::memset(histograms, 0, sizeof(histograms));
+  for (int r = 0; r < nruns; r++) {
+    uint32_t v = col.values[r];
+    for (int p = 0; p < last; p++) {
+      histograms[p][(v >> (p * nbits)) & mask]++;
+    }
+    histograms[last][(v >> (last * nbits)) & mask] += col.lengths[r];
+  }
+
+  for (int p = 0; p < last; p++) {
+    int* h = histograms[p];
+    if (!histogram_to_offsets(h, nradixes, nruns)) continue;
+    int shift = p * nbits;
+    for (int i = 0; i < nruns; i++) {
+      uint32_t v = rv[i];
+      int k = h[(v >> shift) & mask]++;
+      rv2[k] = v;
+      ri2[k] = ri[i];
+    }
+    rv.swap(rv2);
+    ri.swap(ri2);
+  }
+
+  int* h = histograms[last];
+  int shift = last * nbits;
+  int cumsum = 0;
+  for (int b = 0; b < nradixes; b++) {
+    int t = h[b];
+    h[b] = cumsum;
+    cumsum += t;
+  }
+  assert(cumsum == n);
+  for (int i = 0; i < nruns; i++) {
+    uint32_t v = rv[i];
+    int r = ri[i];
+    int len = col.lengths[r];
+    int k = h[(v >> shift) & mask];
+    h[(v >> shift) & mask] = k + len;
+    for (int j = 0; j < len; j++) {
+      x[k + j] = v;
+      o[k + j] = starts[r] + j;
+    }
+  }
+}
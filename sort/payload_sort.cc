@@ -0,0 +1,226 @@
+//==============================================================================
+// Sorting keys together with payload columns
+//==============================================================================
+#include <algorithm>    // std::min, std::swap
+#include <cstring>      // std::memset, std::memcpy
+#include <stdint.h>
+#include <assert.h>
+#include "thpool3/api.h"
+#include "sort.h"
+
+// Maximum number of bits processed by a single LSD radix pass.
+static constexpr int PAYLOAD_RADIX_BITS = 11;
+
+// Enough passes to cover a 64-bit key.
+static constexpr int PAYLOAD_MAX_PASSES = 6;
+
+// Number of rows gathered at a time by each thread in `gather_cols()`. The
+// ordering indices of the block stay in L1 while every column is gathered.
+static constexpr int GATHER_BLOCK = 4096;
+
+
+
+//------------------------------------------------------------------------------
+// Payload sort (carry the columns through every pass)
+//------------------------------------------------------------------------------
+
+// Scatter `src` into `dst` according to the radix of the keys `x`. `starts`
+// holds the offsets of each bucket, and `h` is the working copy of it.
+template <typename T, typename V>
+static void scatter_by_key(const T* x, const V* src, V* dst, int n, int shift,
+                           T mask, const int* starts, int* h, int nradixes)
+{
+  std::memcpy(h, starts, nradixes * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    int k = static_cast<int>((x[i] >> shift) & mask);
+    dst[h[k]++] = src[i];
+  }
+}
+
+
+template <typename T>
+static void scatter_col(const T* x, const void* src, void* dst, int elemsize,
+                        int n, int shift, T mask, const int* starts, int* h,
+                        int nradixes)
+{
+  switch (elemsize) {
+    case 1: scatter_by_key(x, static_cast<const uint8_t*>(src),
+                           static_cast<uint8_t*>(dst), n, shift, mask,
+                           starts, h, nradixes); break;
+    case 2: scatter_by_key(x, static_cast<const uint16_t*>(src),
+                           static_cast<uint16_t*>(dst), n, shift, mask,
+                           starts, h, nradixes); break;
+    case 4: scatter_by_key(x, static_cast<const uint32_t*>(src),
+                           static_cast<uint32_t*>(dst), n, shift, mask,
+                           starts, h, nradixes); break;
+    case 8: scatter_by_key(x, static_cast<const uint64_t*>(src),
+                           static_cast<uint64_t*>(dst), n, shift, mask,
+                           starts, h, nradixes); break;
+    default: assert(false);
+  }
+}
+
+
+// Size of the part of tmp3 used by payload_sort for a column of `n` elements
+// of `elemsize` bytes. The size is rounded up to a multiple of 8 bytes, so
+// that the part of the next column stays aligned whatever the widths.
+static size_t scratch_slice(int n, int elemsize) {
+  return (static_cast<size_t>(n) * elemsize + 7) & ~size_t(7);
+}
+
+
+size_t payload_scratch_size(int n, const payload_col* cols, int ncols) {
+  size_t size = 0;
+  for (int c = 0; c < ncols; c++) size += scratch_slice(n, cols[c].elemsize);
+  return size;
+}
+
+
+// Stable LSD radix sort of `x` which moves the ordering `o` and each of the
+// `ncols` payload columns along with the keys, so that no gather is needed
+// afterwards. On return `x`, `o` and all `cols` are in the sorted order.
+//
+// All histograms are computed in a single read of `x`; passes in which all
+// keys fall into the same bucket are skipped. Within a pass every column is
+// scattered in its own loop, re-deriving the bucket from the key, which
+// keeps the inner loops free of any dispatch on the element size.
+//
+// tmp1 should have at least `n` elements of type T.
+// tmp2 should have at least `n` ints.
+// tmp3 should have at least `payload_scratch_size(n, cols, ncols)` bytes.
+template <typename T>
+void payload_sort(T* x, int* o, int n, int K, payload_col* cols, int ncols)
+{
+  assert(ncols <= MAX_PAYLOAD_COLS);
+  assert(tmp1.size() >= n * sizeof(T));
+  assert(tmp2.size() >= n * sizeof(int));
+  assert(tmp3.size() >= payload_scratch_size(n, cols, ncols));
+  if (n <= 1 || K == 0) return;
+
+  int npasses = (K + PAYLOAD_RADIX_BITS - 1) / PAYLOAD_RADIX_BITS;
+  int nbits = (K + npasses - 1) / npasses;
+  int nradixes = 1 << nbits;
+  T mask = static_cast<T>(nradixes - 1);
+  assert(npasses <= PAYLOAD_MAX_PASSES);
+
+  int histograms[PAYLOAD_MAX_PASSES][1 << PAYLOAD_RADIX_BITS];
+  int h[1 << PAYLOAD_RADIX_BITS];
+  std::memset(histograms, 0, sizeof(histograms));
+  for (int i = 0; i < n; i++) {
+    T xi = x[i];
+    for (int p = 0; p < npasses; p++) {
+      histograms[p][(xi >> (p * nbits)) & mask]++;
+    }
+  }
+
+  // Ping-pong buffers for the keys, the ordering and each payload column
+  T* xsrc = x;
+  T* xdst = tmp1.get<T>();
+  int* osrc = o;
+  int* odst = tmp2.get<int>();
+  void* csrc[MAX_PAYLOAD_COLS];
+  void* cdst[MAX_PAYLOAD_COLS];
+  char* scratch = tmp3.get<char>();
+  for (int c = 0; c < ncols; c++) {
+    csrc[c] = cols[c].data;
+    cdst[c] = scratch;
+    scratch += scratch_slice(n, cols[c].elemsize);
+  }
+
+  for (int p = 0; p < npasses; p++) {
+    int* starts = histograms[p];
+    int cumsum = 0;
+    bool trivial = false;
+    for (int r = 0; r < nradixes; r++) {
+      int t = starts[r];
+      if (t == n) { trivial = true; break; }
+      starts[r] = cumsum;
+      cumsum += t;
+    }
+    if (trivial) continue;
+
+    int shift = p * nbits;
+    scatter_by_key(xsrc, osrc, odst, n, shift, mask, starts, h, nradixes);
+    for (int c = 0; c < ncols; c++) {
+      scatter_col(xsrc, csrc[c], cdst[c], cols[c].elemsize, n, shift, mask,
+                  starts, h, nradixes);
+      std::swap(csrc[c], cdst[c]);
+    }
+    // The keys go last, since the other columns are scattered by them
+    scatter_by_key(xsrc, xsrc, xdst, n, shift, mask, starts, h, nradixes);
+    std::swap(xsrc, xdst);
+    std::swap(osrc, odst);
+  }
+
+  if (xsrc != x) {
+    std::memcpy(x, xsrc, n * sizeof(T));
+    std::memcpy(o, osrc, n * sizeof(int));
+    for (int c = 0; c < ncols; c++) {
+      std::memcpy(cols[c].data, csrc[c], n * cols[c].elemsize);
+    }
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Gather (reorder the columns after the sort)
+//------------------------------------------------------------------------------
+
+template <typename V>
+static void gather_block(const int* o, size_t i0, size_t i1, const void* src,
+                         void* dst)
+{
+  const V* s = static_cast<const V*>(src);
+  V* d = static_cast<V*>(dst);
+  for (size_t i = i0; i < i1; i++) {
+    d[i] = s[o[i]];
+  }
+}
+
+
+// Gather the rows [i0, i1) of every column, one column after another, so
+// that this block of `o` is read from memory only once.
+static void gather_range(const int* o, size_t i0, size_t i1,
+                         const payload_col* src, payload_col* dst, int ncols)
+{
+  for (int c = 0; c < ncols; c++) {
+    assert(src[c].elemsize == dst[c].elemsize);
+    switch (src[c].elemsize) {
+      case 1: gather_block<uint8_t>(o, i0, i1, src[c].data, dst[c].data); break;
+      case 2: gather_block<uint16_t>(o, i0, i1, src[c].data, dst[c].data); break;
+      case 4: gather_block<uint32_t>(o, i0, i1, src[c].data, dst[c].data); break;
+      case 8: gather_block<uint64_t>(o, i0, i1, src[c].data, dst[c].data); break;
+      default: assert(false);
+    }
+  }
+}
+
+
+// Write `dst[c][i] = src[c][o[i]]` for every column. The rows are split into
+// blocks of GATHER_BLOCK, and the blocks are distributed among `nthreads`
+// threads of the dt3 pool; with a single thread the blocks are gathered in
+// the calling thread, without going through the pool.
+void gather_cols(const int* o, int n, const payload_col* src,
+                 payload_col* dst, int ncols, size_t nthreads)
+{
+  size_t nrows = static_cast<size_t>(n);
+  size_t nblocks = (nrows + GATHER_BLOCK - 1) / GATHER_BLOCK;
+  if (nthreads == 1) {
+    for (size_t i0 = 0; i0 < nrows; i0 += GATHER_BLOCK) {
+      gather_range(o, i0, std::min(i0 + GATHER_BLOCK, nrows), src, dst, ncols);
+    }
+    return;
+  }
+  dt3::parallel_for_static(nblocks, 1, nthreads,
+    [&](size_t b) {
+      size_t i0 = b * GATHER_BLOCK;
+      gather_range(o, i0, std::min(i0 + GATHER_BLOCK, nrows), src, dst, ncols);
+    });
+}
+
+
+template void payload_sort(uint8_t*,  int*, int, int, payload_col*, int);
+template void payload_sort(uint16_t*, int*, int, int, payload_col*, int);
+template void payload_sort(uint32_t*, int*, int, int, payload_col*, int);
+template void payload_sort(uint64_t*, int*, int, int, payload_col*, int);
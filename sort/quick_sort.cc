@@ -0,0 +1,416 @@
+//==============================================================================
+// Unstable in-place quick sort (pattern-defeating, block partitioning)
+//==============================================================================
+#include <algorithm>    // std::min, std::swap
+#include <stdint.h>
+#include "sort.h"
+
+// Subarrays smaller than this are sorted with the insertion sort.
+static constexpr int QS_INSERTION_MAX = 24;
+
+// Above this size the pivot is the median of three medians of three
+// (Tukey's ninther), below it the median of three.
+static constexpr int QS_NINTHER_MIN = 128;
+
+// Partial insertion sort gives up after moving this many elements.
+static constexpr int QS_PARTIAL_INSERTION_LIMIT = 8;
+
+// Number of elements whose comparison results are buffered in the block
+// partitioning. The buffers of offsets (2 x 64 bytes) stay in L1.
+static constexpr int QS_BLOCK = 64;
+
+
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+
+// The array being sorted: keys `x`, and when `O` is true the ordering `o`
+// which is permuted together with the keys.
+template <typename T, bool O>
+struct qs_array {
+  T* x;
+  int* o;
+
+  void swap(int i, int j) const {
+    std::swap(x[i], x[j]);
+    if (O) std::swap(o[i], o[j]);
+  }
+  void move(int dst, int src) const {
+    x[dst] = x[src];
+    if (O) o[dst] = o[src];
+  }
+  bool less(int i, int j) const { return x[i] < x[j]; }
+
+  void sort2(int i, int j) const {
+    if (less(j, i)) swap(i, j);
+  }
+  void sort3(int i, int j, int k) const {
+    sort2(i, j);
+    sort2(j, k);
+    sort2(i, j);
+  }
+};
+
+
+// If `guarded` is false, then there must be an element no greater than any
+// of x[begin..end) at position begin - 1.
+template <typename T, bool O, bool guarded>
+static void qs_insertion_sort(const qs_array<T, O>& a, int begin, int end) {
+  for (int i = begin + 1; i < end; i++) {
+    if (!(a.x[i] < a.x[i - 1])) continue;
+    T xi = a.x[i];
+    int oi = O? a.o[i] : 0;
+    int j = i;
+    do {
+      a.move(j, j - 1);
+      j--;
+    } while ((!guarded || j > begin) && xi < a.x[j - 1]);
+    a.x[j] = xi;
+    if (O) a.o[j] = oi;
+  }
+}
+
+
+// Insertion sort that gives up after moving QS_PARTIAL_INSERTION_LIMIT
+// elements; returns true if the range ended up sorted.
+template <typename T, bool O>
+static bool qs_partial_insertion_sort(const qs_array<T, O>& a, int begin,
+                                      int end)
+{
+  int moved = 0;
+  for (int i = begin + 1; i < end; i++) {
+    if (!(a.x[i] < a.x[i - 1])) continue;
+    T xi = a.x[i];
+    int oi = O? a.o[i] : 0;
+    int j = i;
+    do {
+      a.move(j, j - 1);
+      j--;
+    } while (j > begin && xi < a.x[j - 1]);
+    a.x[j] = xi;
+    if (O) a.o[j] = oi;
+    moved += i - j;
+    if (moved > QS_PARTIAL_INSERTION_LIMIT) return false;
+  }
+  return true;
+}
+
+
+template <typename T, bool O>
+static void qs_sift_down(const qs_array<T, O>& a, int base, int i, int n) {
+  while (true) {
+    int child = 2 * i + 1;
+    if (child >= n) break;
+    if (child + 1 < n && a.less(base + child, base + child + 1)) child++;
+    if (!a.less(base + i, base + child)) break;
+    a.swap(base + i, base + child);
+    i = child;
+  }
+}
+
+// Fallback for the subarrays where the pivots keep being bad: guarantees
+// O(n log n) regardless of the input.
+template <typename T, bool O>
+static void qs_heap_sort(const qs_array<T, O>& a, int begin, int end) {
+  int n = end - begin;
+  for (int i = n / 2 - 1; i >= 0; i--) {
+    qs_sift_down(a, begin, i, n);
+  }
+  for (int m = n - 1; m > 0; m--) {
+    a.swap(begin, begin + m);
+    qs_sift_down(a, begin, 0, m);
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Partitioning
+//------------------------------------------------------------------------------
+
+// Swap the elements at `first + offsets_l[i]` with the elements at
+// `last - offsets_r[i]`. When the number of misplaced elements differs on
+// the two sides, a cyclic permutation is used, which needs fewer moves than
+// the pairwise swaps.
+template <typename T, bool O>
+static void qs_swap_offsets(const qs_array<T, O>& a, int first, int last,
+                            const unsigned char* offsets_l,
+                            const unsigned char* offsets_r,
+                            int num, bool use_swaps)
+{
+  if (use_swaps) {
+    for (int i = 0; i < num; i++) {
+      a.swap(first + offsets_l[i], last - offsets_r[i]);
+    }
+  } else if (num > 0) {
+    int l = first + offsets_l[0];
+    int r = last - offsets_r[0];
+    T tx = a.x[l];
+    int to = O? a.o[l] : 0;
+    a.move(l, r);
+    for (int i = 1; i < num; i++) {
+      l = first + offsets_l[i];
+      a.move(r, l);
+      r = last - offsets_r[i];
+      a.move(l, r);
+    }
+    a.x[r] = tx;
+    if (O) a.o[r] = to;
+  }
+}
+
+
+// Partition [begin, end) around the pivot x[begin]: elements less than the
+// pivot go to the left, and the rest to the right. The comparisons are
+// made branch-free over blocks of QS_BLOCK elements on each side, recording
+// the offsets of the misplaced elements, which are then swapped in bulk
+// (BlockQuicksort). Returns the final position of the pivot; `partitioned`
+// is set when no elements had to be moved.
+// There must be an element no less than the pivot in (begin, end), and an
+// element less than the pivot at begin - 1 or within the range (both are
+// ensured by the median-of-three pivot selection).
+template <typename T, bool O>
+static int qs_partition_right(const qs_array<T, O>& a, int begin, int end,
+                              bool* partitioned)
+{
+  T* x = a.x;
+  T pivot = x[begin];
+  int opivot = O? a.o[begin] : 0;
+  int first = begin;
+  int last = end;
+
+  while (x[++first] < pivot) {}
+  if (first - 1 == begin) {
+    while (first < last && !(x[--last] < pivot)) {}
+  } else {
+    while (!(x[--last] < pivot)) {}
+  }
+  *partitioned = first >= last;
+
+  if (!*partitioned) {
+    a.swap(first, last);
+    first++;
+
+    alignas(64) unsigned char offsets_l[QS_BLOCK];
+    alignas(64) unsigned char offsets_r[QS_BLOCK];
+    int num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+    while (last - first > 2 * QS_BLOCK) {
+      if (num_l == 0) {
+        start_l = 0;
+        for (int i = 0; i < QS_BLOCK; i++) {
+          offsets_l[num_l] = static_cast<unsigned char>(i);
+          num_l += !(x[first + i] < pivot);
+        }
+      }
+      if (num_r == 0) {
+        start_r = 0;
+        for (int i = 1; i <= QS_BLOCK; i++) {
+          offsets_r[num_r] = static_cast<unsigned char>(i);
+          num_r += (x[last - i] < pivot);
+        }
+      }
+      int num = std::min(num_l, num_r);
+      qs_swap_offsets(a, first, last, offsets_l + start_l,
+                      offsets_r + start_r, num, num_l == num_r);
+      num_l -= num;
+      num_r -= num;
+      start_l += num;
+      start_r += num;
+      if (num_l == 0) first += QS_BLOCK;
+      if (num_r == 0) last -= QS_BLOCK;
+    }
+
+    // The remaining elements: at most one block on each side is still
+    // being processed, the rest is split between the two sides.
+    int l_size, r_size;
+    int unknown = (last - first) - ((num_r || num_l)? QS_BLOCK : 0);
+    if (num_r) {
+      l_size = unknown;
+      r_size = QS_BLOCK;
+    } else if (num_l) {
+      l_size = QS_BLOCK;
+      r_size = unknown;
+    } else {
+      l_size = unknown / 2;
+      r_size = unknown - l_size;
+    }
+    if (l_size && num_l == 0) {
+      start_l = 0;
+      for (int i = 0; i < l_size; i++) {
+        offsets_l[num_l] = static_cast<unsigned char>(i);
+        num_l += !(x[first + i] < pivot);
+      }
+    }
+    if (r_size && num_r == 0) {
+      start_r = 0;
+      for (int i = 1; i <= r_size; i++) {
+        offsets_r[num_r] = static_cast<unsigned char>(i);
+        num_r += (x[last - i] < pivot);
+      }
+    }
+    int num = std::min(num_l, num_r);
+    qs_swap_offsets(a, first, last, offsets_l + start_l, offsets_r + start_r,
+                    num, num_l == num_r);
+    num_l -= num;
+    num_r -= num;
+    start_l += num;
+    start_r += num;
+    if (num_l == 0) first += l_size;
+    if (num_r == 0) last -= r_size;
+
+    // Move the misplaced elements left over on one of the sides
+    if (num_l) {
+      while (num_l--) a.swap(first + offsets_l[start_l + num_l], --last);
+      first = last;
+    }
+    if (num_r) {
+      while (num_r--) a.swap(last - offsets_r[start_r + num_r], first++);
+      last = first;
+    }
+  }
+
+  int pivot_pos = first - 1;
+  a.move(begin, pivot_pos);
+  x[pivot_pos] = pivot;
+  if (O) a.o[pivot_pos] = opivot;
+  return pivot_pos;
+}
+
+
+// Partition [begin, end) so that the elements equal to the pivot x[begin]
+// go to the left. This is used when the pivot equals the element preceding
+// the range, in which case the whole left part is equal to it and needs no
+// further sorting. Returns the final position of the pivot.
+template <typename T, bool O>
+static int qs_partition_left(const qs_array<T, O>& a, int begin, int end) {
+  T* x = a.x;
+  T pivot = x[begin];
+  int opivot = O? a.o[begin] : 0;
+  int first = begin;
+  int last = end;
+
+  while (pivot < x[--last]) {}
+  if (last + 1 == end) {
+    while (first < last && !(pivot < x[++first])) {}
+  } else {
+    while (!(pivot < x[++first])) {}
+  }
+  while (first < last) {
+    a.swap(first, last);
+    while (pivot < x[--last]) {}
+    while (!(pivot < x[++first])) {}
+  }
+
+  int pivot_pos = last;
+  a.move(begin, pivot_pos);
+  x[pivot_pos] = pivot;
+  if (O) a.o[pivot_pos] = opivot;
+  return pivot_pos;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Quick sort
+//------------------------------------------------------------------------------
+
+// Sort [begin, end). `bad_allowed` is the number of highly unbalanced
+// partitions tolerated before switching to the heap sort; `leftmost` is
+// false when x[begin - 1] is a pivot from an enclosing call (no greater
+// than any element of the range).
+template <typename T, bool O>
+static void qs_loop(const qs_array<T, O>& a, int begin, int end,
+                    int bad_allowed, bool leftmost)
+{
+  while (true) {
+    int size = end - begin;
+    if (size < QS_INSERTION_MAX) {
+      if (leftmost) qs_insertion_sort<T, O, true>(a, begin, end);
+      else          qs_insertion_sort<T, O, false>(a, begin, end);
+      return;
+    }
+
+    // Choose the pivot and move it to x[begin]
+    int s2 = size / 2;
+    if (size > QS_NINTHER_MIN) {
+      a.sort3(begin, begin + s2, end - 1);
+      a.sort3(begin + 1, begin + (s2 - 1), end - 2);
+      a.sort3(begin + 2, begin + (s2 + 1), end - 3);
+      a.sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1));
+      a.swap(begin, begin + s2);
+    } else {
+      a.sort3(begin + s2, begin, end - 1);
+    }
+
+    // Many elements equal to the preceding pivot: put them to the left,
+    // where they are already in their final place.
+    if (!leftmost && !a.less(begin - 1, begin)) {
+      begin = qs_partition_left(a, begin, end) + 1;
+      continue;
+    }
+
+    bool partitioned;
+    int pivot_pos = qs_partition_right(a, begin, end, &partitioned);
+    int l_size = pivot_pos - begin;
+    int r_size = end - (pivot_pos + 1);
+
+    if (l_size < size / 8 || r_size < size / 8) {
+      // A bad pivot: fall back to the heap sort if this keeps happening,
+      // otherwise shuffle a few elements to break up the pattern that
+      // caused it.
+      if (--bad_allowed == 0) {
+        qs_heap_sort(a, begin, end);
+        return;
+      }
+      if (l_size >= QS_INSERTION_MAX) {
+        a.swap(begin, begin + l_size / 4);
+        a.swap(pivot_pos - 1, pivot_pos - l_size / 4);
+        if (l_size > QS_NINTHER_MIN) {
+          a.swap(begin + 1, begin + (l_size / 4 + 1));
+          a.swap(begin + 2, begin + (l_size / 4 + 2));
+          a.swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+          a.swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+        }
+      }
+      if (r_size >= QS_INSERTION_MAX) {
+        a.swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+        a.swap(end - 1, end - r_size / 4);
+        if (r_size > QS_NINTHER_MIN) {
+          a.swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+          a.swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+          a.swap(end - 2, end - (1 + r_size / 4));
+          a.swap(end - 3, end - (2 + r_size / 4));
+        }
+      }
+    } else if (partitioned &&
+               qs_partial_insertion_sort(a, begin, pivot_pos) &&
+               qs_partial_insertion_sort(a, pivot_pos + 1, end)) {
+      // The input was (nearly) sorted already
+      return;
+    }
+
+    // Recurse into the left part, and loop over the right part
+    qs_loop(a, begin, pivot_pos, bad_allowed, leftmost);
+    begin = pivot_pos + 1;
+    leftmost = false;
+  }
+}
+
+
+// Unstable in-place sort of the keys `x`. If `o` is not null, it is permuted
+// together with the keys (so that equal keys may end up with their `o` in
+// any order). Needs no scratch memory beyond O(log n) stack.
+template <typename T>
+void quick_sort(T* x, int* o, int n, int)
+{
+  if (n < 2) return;
+  int log2n = 31 - __builtin_clz(static_cast<unsigned>(n));
+  if (o) qs_loop(qs_array<T, true>{x, o}, 0, n, log2n, true);
+  else   qs_loop(qs_array<T, false>{x, nullptr}, 0, n, log2n, true);
+}
+
+template void quick_sort(uint8_t*,  int*, int, int);
+template void quick_sort(uint16_t*, int*, int, int);
+template void quick_sort(uint32_t*, int*, int, int);
+template void quick_sort(uint64_t*, int*, int, int);
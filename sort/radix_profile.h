@@ -0,0 +1,123 @@
+//==============================================================================
+// Optional per-phase timing of the radix sorts
+//==============================================================================
+#ifndef MICROBENCH_RADIX_PROFILE_H
+#define MICROBENCH_RADIX_PROFILE_H
+// Compile with -DRADIX_PROFILE (`make PROFILE=1`) to accumulate the time and
+// the number of elements processed by each phase of radix_sort1/radix_sort3
+// (and the radix_sort4 passes that the leaf sorts run), per recursion depth.
+// Leaf sorts are additionally bucketed by their size. Without the flag all
+// the macros below expand to nothing.
+#ifdef RADIX_PROFILE
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>  // __rdtsc
+#endif
+
+// Reference-cycle counter: rdtsc where available, nanoseconds otherwise.
+static inline uint64_t profile_ticks() {
+  #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+  #else
+    return static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+  #endif
+}
+
+
+struct radix_profile {
+  enum Phase { HISTOGRAM, PREFIX, SCATTER, LEAF, MEMCPY, NPHASES };
+  static constexpr int MAX_DEPTH = 4;
+  static constexpr int NSIZES = 32;
+
+  uint64_t ticks[MAX_DEPTH][NPHASES];
+  uint64_t elems[MAX_DEPTH][NPHASES];
+  // Leaf sorts, bucketed by floor(log2(n))
+  uint64_t leaf_calls[NSIZES];
+  uint64_t leaf_elems[NSIZES];
+  uint64_t leaf_ticks[NSIZES];
+  int depth;
+
+  radix_profile() { reset(); }
+
+  void reset() {
+    std::memset(this, 0, sizeof(*this));
+  }
+
+  void add(Phase p, uint64_t t0, int n) {
+    int d = depth < MAX_DEPTH? depth : MAX_DEPTH - 1;
+    ticks[d][p] += profile_ticks() - t0;
+    elems[d][p] += static_cast<uint64_t>(n);
+  }
+
+  void add_leaf(uint64_t t0, int n) {
+    uint64_t t = profile_ticks() - t0;
+    int d = depth < MAX_DEPTH? depth : MAX_DEPTH - 1;
+    int b = 31 - __builtin_clz(static_cast<unsigned>(n));
+    ticks[d][LEAF] += t;
+    elems[d][LEAF] += static_cast<uint64_t>(n);
+    leaf_calls[b]++;
+    leaf_elems[b] += static_cast<uint64_t>(n);
+    leaf_ticks[b] += t;
+  }
+
+  // Print the accumulated values averaged over `nsorts` top-level sorts.
+  // Leaf time at depth d includes any radix passes (at depth d+1) that the
+  // leaf sorts themselves perform.
+  void print(size_t nsorts) const {
+    static const char* names[NPHASES] = {
+      "histogram", "prefix", "scatter", "leaf", "memcpy"
+    };
+    uint64_t total = 0;
+    for (int p = 0; p < NPHASES; p++) total += ticks[0][p];
+    if (total == 0 || nsorts == 0) return;
+    double ns = static_cast<double>(nsorts);
+    printf("    %-5s %-10s %14s %7s %12s %10s\n",
+           "depth", "phase", "ticks/sort", "share", "elems/sort", "ticks/elem");
+    for (int d = 0; d < MAX_DEPTH; d++) {
+      for (int p = 0; p < NPHASES; p++) {
+        if (!ticks[d][p]) continue;
+        printf("    %-5d %-10s %14.0f %6.1f%% %12.0f %10.2f\n",
+               d, names[p], ticks[d][p] / ns, 100.0 * ticks[d][p] / total,
+               elems[d][p] / ns,
+               elems[d][p]? 1.0 * ticks[d][p] / elems[d][p] : 0.0);
+      }
+    }
+    printf("    %-14s %12s %10s %14s %10s\n",
+           "leaf size", "calls/sort", "avg n", "ticks/call", "ticks/elem");
+    for (int b = 0; b < NSIZES; b++) {
+      if (!leaf_calls[b]) continue;
+      char range[32];
+      snprintf(range, sizeof(range), "%u..%u", 1u << b, (2u << b) - 1);
+      printf("    %-14s %12.1f %10.1f %14.1f %10.2f\n",
+             range, leaf_calls[b] / ns, 1.0 * leaf_elems[b] / leaf_calls[b],
+             1.0 * leaf_ticks[b] / leaf_calls[b],
+             1.0 * leaf_ticks[b] / leaf_elems[b]);
+    }
+  }
+};
+
+extern radix_profile radix_prof;
+
+#define RADIX_PROFILE_START(t)      uint64_t t = profile_ticks()
+#define RADIX_PROFILE_ADD(p, t, n)  radix_prof.add(radix_profile::p, t, n)
+#define RADIX_PROFILE_LEAF(t, n)    radix_prof.add_leaf(t, n)
+#define RADIX_PROFILE_ENTER()       radix_prof.depth++
+#define RADIX_PROFILE_LEAVE()       radix_prof.depth--
+#define RADIX_PROFILE_RESET()       radix_prof.reset()
+#define RADIX_PROFILE_PRINT(n)      radix_prof.print(n)
+
+#else
+#define RADIX_PROFILE_START(t)
+#define RADIX_PROFILE_ADD(p, t, n)
+#define RADIX_PROFILE_LEAF(t, n)
+#define RADIX_PROFILE_ENTER()
+#define RADIX_PROFILE_LEAVE()
+#define RADIX_PROFILE_RESET()
+#define RADIX_PROFILE_PRINT(n)
+#endif
+
+#endif
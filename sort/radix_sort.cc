@@ -1,14 +1,23 @@
 //==============================================================================
 // Micro benchmark for radix sort function
 //==============================================================================
-#include <cstring>      // std::memset, std::memcpy
+#include <algorithm>    // std::sort
+#include <array>        // std::array
+#include <cstring>      // std::memset, std::memcpy, std::strcmp
 #include <type_traits>  // std::is_integral
+#include <utility>      // std::integer_sequence
+#include <vector>       // std::vector
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <assert.h>
+#include "radix_profile.h"
 #include "sort.h"
 
+#ifdef RADIX_PROFILE
+radix_profile radix_prof;
+#endif
+
 
 
 
@@ -16,31 +25,23 @@
 // Counting Sort 0
 //------------------------------------------------------------------------------
 
-// Counting sort (equivalent to radix sort using all K bits)
+// Generic counting sort: `key(x[i])` must map each element into the range
+// [0, nradixes). The key is evaluated twice per element (once when building
+// the histogram, and once during the scatter), so it should be cheap.
 // tmp2 should have at least `n` ints.
-// tmp3 should be at least `1 << K` ints long.
-template <typename T, bool masked>
-void count_sort0(T* x, int* o, int n, int K)
+// tmp3 should be at least `nradixes` ints long.
+template <typename T, typename F>
+static void count_sort_impl(T* x, int* o, int n, int nradixes, F key)
 {
-  static_assert(std::is_integral<T>::value);
-  static_assert(std::is_unsigned<T>::value);
   assert(tmp2.size() >= n * sizeof(int));
-  assert(tmp3.size() >= (1<<K) * sizeof(int));
+  assert(tmp3.size() >= nradixes * sizeof(int));
   int* oo = tmp2.get<int>();
   int* histogram = tmp3.get<int>();
-
-  int nradixes = 1 << K;
-  int mask = nradixes - 1;
   std::memset(histogram, 0, nradixes * sizeof(int));
 
   // Generate the histogram
   for (int i = 0; i < n; i++) {
-    if constexpr(masked) {
-      histogram[x[i] & mask]++;
-    } else {
-      assert(x[i] < nradixes);
-      histogram[x[i]]++;
-    }
+    histogram[key(x[i])]++;
   }
   int cumsum = 0;
   for (int i = 0; i < nradixes; i++) {
@@ -52,14 +53,35 @@ void count_sort0(T* x, int* o, int n, int K)
 
   // Sort the variables using the histogram
   for (int i = 0; i < n; i++) {
-    int k = masked? histogram[x[i] & mask]++
-                  : histogram[x[i]]++;
+    int k = histogram[key(x[i])]++;
     assert(k < n);
     oo[k] = o[i];
   }
   std::memcpy(o, oo, n * sizeof(int));
 }
 
+
+// Counting sort (equivalent to radix sort using all K bits)
+// tmp2 should have at least `n` ints.
+// tmp3 should be at least `1 << K` ints long.
+template <typename T, bool masked>
+void count_sort0(T* x, int* o, int n, int K)
+{
+  static_assert(std::is_integral<T>::value);
+  static_assert(std::is_unsigned<T>::value);
+  int nradixes = 1 << K;
+  T mask = static_cast<T>(nradixes - 1);
+  count_sort_impl(x, o, n, nradixes,
+    [=](T v) -> int {
+      if constexpr(masked) {
+        return static_cast<int>(v & mask);
+      } else {
+        assert(v <= mask);
+        return static_cast<int>(v);
+      }
+    });
+}
+
 template void count_sort0<uint8_t,  false>(uint8_t*,  int*, int, int);
 template void count_sort0<uint16_t, false>(uint16_t*, int*, int, int);
 template void count_sort0<uint32_t, false>(uint32_t*, int*, int, int);
@@ -68,6 +90,57 @@ template void count_sort0<uint64_t, false>(uint64_t*, int*, int, int);
 
 
 
+//------------------------------------------------------------------------------
+// Categorical Sort
+//------------------------------------------------------------------------------
+
+// Compute the rank of each entry of the dictionary `dict` (of size `ndict`)
+// in the lexicographical order. Equal strings receive equal ranks, so that
+// the ranks are dense in [0, nranks). The return value is `nranks`.
+// This function is meant to be called once per dictionary, the resulting
+// `rank` array can then be reused for sorting any number of code arrays.
+int cat_sort_ranks(const char* const* dict, int ndict, int* rank)
+{
+  std::vector<int> order(ndict);
+  for (int i = 0; i < ndict; i++) order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [=](int a, int b) { return std::strcmp(dict[a], dict[b]) < 0; });
+  int r = -1;
+  const char* prev = nullptr;
+  for (int i = 0; i < ndict; i++) {
+    const char* s = dict[order[i]];
+    if (!prev || std::strcmp(prev, s) != 0) r++;
+    rank[order[i]] = r;
+    prev = s;
+  }
+  return r + 1;
+}
+
+
+// Sort dictionary-encoded column `x` by the string values of its categories.
+// Here `rank` is the code-to-rank map produced by `cat_sort_ranks()`. The
+// codes are remapped into ranks on the fly, i.e. the remap is fused with the
+// histogram pass of the counting sort, and no remapped copy of `x` is ever
+// materialized.
+// tmp2 should have at least `n` ints.
+// tmp3 should be at least `nranks` ints long.
+template <typename T>
+void cat_sort0(T* x, int* o, int n, const int* rank, int nranks)
+{
+  static_assert(std::is_integral<T>::value);
+  static_assert(std::is_unsigned<T>::value);
+  count_sort_impl(x, o, n, nranks,
+    [=](T v) -> int { return rank[v]; });
+}
+
+template void cat_sort0(uint8_t*,  int*, int, const int*, int);
+template void cat_sort0(uint16_t*, int*, int, const int*, int);
+template void cat_sort0(uint32_t*, int*, int, const int*, int);
+template void cat_sort0(uint64_t*, int*, int, const int*, int);
+
+
+
+
 //------------------------------------------------------------------------------
 // Radix Sort 1
 //------------------------------------------------------------------------------
@@ -111,16 +184,17 @@ static void bestsort1(T* x, int* o, int n, int K) {
   }
 }
 
+template <typename T, int B>
+static void radix_sort4_impl(T* x, int* o, int n, int K);
+
 template <typename T>
 static void bestsort_k10(T* x, int* o, int n, int K) {
   if (n <= 24) {
     insert_sort0<T>(x, o, n, K);
   } else if (n <= 90 || n > 10000) {
-    tmp0 = 4;
-    radix_sort1<T>(x, o, n, K);
+    radix_sort4_impl<T, 4>(x, o, n, K);
   } else if (n <= 200) {
-    tmp0 = 6;
-    radix_sort1<T>(x, o, n, K);
+    radix_sort4_impl<T, 6>(x, o, n, K);
   } else {
     count_sort0<T, true>(x, o, n, K);
   }
@@ -131,11 +205,9 @@ static void bestsort_k12(T* x, int* o, int n, int K) {
   if (n <= 24) {
     insert_sort0<T>(x, o, n, K);
   } else if (n <= 90 || n > 30000) {
-    tmp0 = 4;
-    radix_sort1<T>(x, o, n, K);
+    radix_sort4_impl<T, 4>(x, o, n, K);
   } else {
-    tmp0 = 6;
-    radix_sort1<T>(x, o, n, K);
+    radix_sort4_impl<T, 6>(x, o, n, K);
   }
 }
 
@@ -170,13 +242,15 @@ static void radix_recurse(TI* x, int* o, int* histogram, int n,
   assert(tmp2.size() >= n * sizeof(int));
   TO*  xx = tmp1.get<TO>();
   int* oo = tmp2.get<int>();
-  int mask = nradixes - 1;
+  TI mask = static_cast<TI>((TI(1) << shift) - 1);
 
+  RADIX_PROFILE_START(t0);
   for (int i = 0; i < n; i++) {
     int k = histogram[x[i] >> shift]++;
     xx[k] = (TO)(x[i] & mask);
     oo[k] = o[i];
   }
+  RADIX_PROFILE_ADD(SCATTER, t0, n);
 
   // Continue sorting the remainder
   tmp1.push(x, n * sizeof(TI));
@@ -188,63 +262,75 @@ static void radix_recurse(TI* x, int* o, int* histogram, int n,
     if (nextn <= 1) continue;
     TO*  nextx = xx + start;
     int* nexto = oo + start;
+    RADIX_PROFILE_START(t1);
+    RADIX_PROFILE_ENTER();
     if constexpr(std::is_same<TO, uint32_t>::value) {
       best_sorts_u32[shift](nextx, nexto, nextn, shift);
     } else {
       bestsort<TO>(nextx, nexto, nextn, shift);
     }
+    RADIX_PROFILE_LEAVE();
+    RADIX_PROFILE_LEAF(t1, nextn);
   }
   tmp2.pop();
   tmp1.pop();
 }
 
 
-// Radix Sort that first partially sorts by `k = tmp0` MSB bits, and then sorts
-// the remaining numbers using "best" sort.
+// Radix Sort that first partially sorts by `nradixbits` MSB bits, and then
+// sorts the remaining numbers using "best" sort.
 // Uses:
 //   tmp1 - array of the same size as x (i.e. n*sizeof(T))
 //   tmp2 - array of the same size as o (i.e. n*sizeof(int))
-//   tmp3 - array of size (1<<tmp0) * sizeof(int)
+//   tmp3 - array of size (1<<nradixbits) * sizeof(int), plus whatever the
+//          leaf sorts need (up to (1<<(K - nradixbits)) * sizeof(int))
 template <typename T>
-void radix_sort1(T* x, int* o, int n, int K)
+void radix_sort1(T* x, int* o, int n, int K, int nradixbits)
 {
   assert(tmp1.size() >= n * sizeof(T));
   assert(tmp2.size() >= n * sizeof(int));
-  assert(tmp3.size() >= (1<<tmp0) * sizeof(int));
+  assert(tmp3.size() >= (1<<nradixbits) * sizeof(int));
   // printf("radixsort1(x=%p, o=%p, n=%d, K=%d)\n", x, o, n, K);
-  int nradixbits = tmp0;
   T*   xx = tmp1.get<T>();
   int* oo = tmp2.get<int>();
   int* histogram = tmp3.get<int>();
 
   int nradixes = 1 << nradixbits;
   int shift = K - nradixbits;
-  int mask = nradixes - 1;
-  // printf("  nradixes=%d, shift=%d, mask=%d\n", nradixes, shift, mask);
+  // printf("  nradixes=%d, shift=%d\n", nradixes, shift);
   std::memset(histogram, 0, nradixes * sizeof(int));
 
   // Generate the histogram
   // printf("  generate histogram...\n");
+  RADIX_PROFILE_START(t0);
   for (int i = 0; i < n; i++) {
     histogram[x[i] >> shift]++;
   }
+  RADIX_PROFILE_ADD(HISTOGRAM, t0, n);
+  RADIX_PROFILE_START(t1);
   int cumsum = 0;
   for (int i = 0; i < nradixes; i++) {
     int h = histogram[i];
     histogram[i] = cumsum;
     cumsum += h;
   }
+  RADIX_PROFILE_ADD(PREFIX, t1, nradixes);
 
-  // Sort the variables using the histogram
+  // Sort the variables using the histogram. The leaf sorts may use tmp3 too,
+  // so make sure they don't overwrite the histogram.
+  tmp3.push(histogram + nradixes, tmp3.size() - nradixes * sizeof(int));
   radix_recurse<T, T>(x, o, histogram, n, nradixes, shift);
+  tmp3.pop();
 
+  RADIX_PROFILE_START(t2);
   std::memcpy(o, oo, n * sizeof(int));
+  RADIX_PROFILE_ADD(MEMCPY, t2, n);
 }
 
-template void radix_sort1(uint8_t*,  int*, int, int);
-template void radix_sort1(uint16_t*, int*, int, int);
-template void radix_sort1(uint32_t*, int*, int, int);
-template void radix_sort1(uint64_t*, int*, int, int);
+template void radix_sort1(uint8_t*,  int*, int, int, int);
+template void radix_sort1(uint16_t*, int*, int, int, int);
+template void radix_sort1(uint32_t*, int*, int, int, int);
+template void radix_sort1(uint64_t*, int*, int, int, int);
 
 
 
@@ -256,9 +342,8 @@ template void radix_sort1(uint64_t*, int*, int, int);
 // This is exactly like radixsort0, but stores output x array more compactly:
 // either as uint8_t or uint16_t.
 template <typename T>
-void radix_sort3(T* x, int* o, int n, int K)
+void radix_sort3(T* x, int* o, int n, int K, int nradixbits)
 {
-  int nradixbits = tmp0;
   int* oo = tmp2.get<int>();
   int* histogram = tmp3.get<int>();
 
@@ -267,15 +352,19 @@ void radix_sort3(T* x, int* o, int n, int K)
   std::memset(histogram, 0, nradixes * sizeof(int));
 
   // Generate the histogram
+  RADIX_PROFILE_START(t0);
   for (int i = 0; i < n; i++) {
     histogram[x[i] >> shift]++;
   }
+  RADIX_PROFILE_ADD(HISTOGRAM, t0, n);
+  RADIX_PROFILE_START(t1);
   int cumsum = 0;
   for (int i = 0; i < nradixes; i++) {
     int h = histogram[i];
     histogram[i] = cumsum;
     cumsum += h;
   }
+  RADIX_PROFILE_ADD(PREFIX, t1, nradixes);
 
   tmp3.push(histogram + nradixes, tmp3.size() - nradixes * sizeof(int));
   if (shift <= 8)       radix_recurse<T, uint8_t >(x, o, histogram, n, nradixes, shift);
@@ -284,10 +373,324 @@ void radix_sort3(T* x, int* o, int n, int K)
   else                  radix_recurse<T, uint64_t>(x, o, histogram, n, nradixes, shift);
   tmp3.pop();
 
+  RADIX_PROFILE_START(t2);
   memcpy(o, oo, n * sizeof(int));
+  RADIX_PROFILE_ADD(MEMCPY, t2, n);
+}
+
+template void radix_sort3(uint8_t*,  int*, int, int, int);
+template void radix_sort3(uint16_t*, int*, int, int, int);
+template void radix_sort3(uint32_t*, int*, int, int, int);
+template void radix_sort3(uint64_t*, int*, int, int, int);
+
+
+
+
+//------------------------------------------------------------------------------
+// Radix Sort 4
+//------------------------------------------------------------------------------
+
+// The largest digit width supported by the compile-time radix kernels.
+static constexpr int RADIX4_MAX_BITS = 16;
+
+// Loop unrolling factor in the histogram / scatter loops.
+static constexpr int RADIX4_UNROLL = 4;
+
+
+// A single MSD radix pass over digits of width `B` bits, where the digit is
+// `x >> shift`. Since the number of buckets is known at compile time, the
+// histogram lives on the stack, and the loops are unrolled by the compiler.
+template <typename T, int B>
+struct radix_pass {
+  static constexpr int NRADIXES = 1 << B;
+
+  // For small digits use several interleaved histograms, so that consecutive
+  // increments of the same bucket do not stall on each other.
+  static constexpr int NHIST = B <= 8 ? RADIX4_UNROLL : 1;
+
+  // Compute the histogram of digits, and convert it into the array of bucket
+  // start offsets.
+  static void histogram(const T* x, int n, int shift, int* hist) {
+    int h[NHIST * NRADIXES];
+    std::memset(h, 0, sizeof(h));
+    int i = 0;
+    for (; i + RADIX4_UNROLL <= n; i += RADIX4_UNROLL) {
+      for (int j = 0; j < RADIX4_UNROLL; j++) {
+        h[(j % NHIST) * NRADIXES + (x[i + j] >> shift)]++;
+      }
+    }
+    for (; i < n; i++) {
+      h[x[i] >> shift]++;
+    }
+    int cumsum = 0;
+    for (int r = 0; r < NRADIXES; r++) {
+      hist[r] = cumsum;
+      for (int j = 0; j < NHIST; j++) {
+        cumsum += h[j * NRADIXES + r];
+      }
+    }
+  }
+
+  // Scatter `x` (reduced to its lower `shift` bits) and `o` into `xx` / `oo`
+  // according to the bucket offsets `hist`. Upon return `hist[r]` contains
+  // the end of bucket `r`.
+  static void scatter(const T* x, const int* o, int n, int shift, int* hist,
+                      T* xx, int* oo) {
+    T mask = static_cast<T>((T(1) << shift) - 1);
+    int i = 0;
+    for (; i + RADIX4_UNROLL <= n; i += RADIX4_UNROLL) {
+      for (int j = 0; j < RADIX4_UNROLL; j++) {
+        T v = x[i + j];
+        int k = hist[v >> shift]++;
+        xx[k] = static_cast<T>(v & mask);
+        oo[k] = o[i + j];
+      }
+    }
+    for (; i < n; i++) {
+      T v = x[i];
+      int k = hist[v >> shift]++;
+      xx[k] = static_cast<T>(v & mask);
+      oo[k] = o[i];
+    }
+  }
+
+  // Same as histogram(), for the keys x[o[i]]. The rows are prefetched
+  // INDIRECT_PREFETCH_DISTANCE iterations ahead, since `o` may refer to
+  // anywhere within `x`.
+  static void histogram_indirect(const T* x, const int* o, int n, int shift,
+                                 int* hist) {
+    int h[NHIST * NRADIXES];
+    std::memset(h, 0, sizeof(h));
+    int i = 0;
+    for (; i + INDIRECT_PREFETCH_DISTANCE < n; i++) {
+      __builtin_prefetch(x + o[i + INDIRECT_PREFETCH_DISTANCE]);
+      h[(i % NHIST) * NRADIXES + (x[o[i]] >> shift)]++;
+    }
+    for (; i < n; i++) {
+      h[x[o[i]] >> shift]++;
+    }
+    int cumsum = 0;
+    for (int r = 0; r < NRADIXES; r++) {
+      hist[r] = cumsum;
+      for (int j = 0; j < NHIST; j++) {
+        cumsum += h[j * NRADIXES + r];
+      }
+    }
+  }
+
+  // Same as scatter(), for the keys x[o[i]]. The keys are written into `xx`
+  // as type TO, which must be wide enough for their lower `shift` bits: the
+  // buckets are then sorted from this compact contiguous copy.
+  template <typename TO>
+  static void scatter_indirect(const T* x, const int* o, int n, int shift,
+                               int* hist, TO* xx, int* oo) {
+    T mask = static_cast<T>((T(1) << shift) - 1);
+    auto move = [&](int i) {
+      T v = x[o[i]];
+      int k = hist[v >> shift]++;
+      xx[k] = static_cast<TO>(v & mask);
+      oo[k] = o[i];
+    };
+    int i = 0;
+    for (; i + INDIRECT_PREFETCH_DISTANCE < n; i++) {
+      __builtin_prefetch(x + o[i + INDIRECT_PREFETCH_DISTANCE]);
+      move(i);
+    }
+    for (; i < n; i++) {
+      move(i);
+    }
+  }
+};
+
+
+// Sort each of the buckets of an MSD radix pass by the lower `shift` bits of
+// the keys, in place. `histogram` contains the end of each bucket.
+template <typename T, int B>
+static void radix4_sort_buckets(T* xx, int* oo, const int* histogram,
+                                int shift)
+{
+  for (int i = 0; i < radix_pass<T, B>::NRADIXES; i++) {
+    int start = i? histogram[i - 1] : 0;
+    int nextn = histogram[i] - start;
+    if (nextn <= 1) continue;
+    T*   nextx = xx + start;
+    int* nexto = oo + start;
+    RADIX_PROFILE_START(t2);
+    RADIX_PROFILE_ENTER();
+    if (shift > 16) {
+      radix_sort4_impl<T, B>(nextx, nexto, nextn, shift);
+    } else if constexpr(std::is_same<T, uint32_t>::value) {
+      best_sorts_u32[shift](nextx, nexto, nextn, shift);
+    } else {
+      bestsort<T>(nextx, nexto, nextn, shift);
+    }
+    RADIX_PROFILE_LEAVE();
+    RADIX_PROFILE_LEAF(t2, nextn);
+  }
+}
+
+
+// Same algorithm as radix_sort1, except that the width of the radix `B` is a
+// compile-time constant, and the histogram is allocated on the stack. Buckets
+// that still have more than 16 significant bits are sorted recursively.
+// Uses:
+//   tmp1 - array of the same size as x (i.e. n*sizeof(T))
+//   tmp2 - array of the same size as o (i.e. n*sizeof(int))
+//   tmp3 - only in the leaf sorts (at most (1<<16) * sizeof(int))
+template <typename T, int B>
+static void radix_sort4_impl(T* x, int* o, int n, int K)
+{
+  static_assert(B >= 1 && B <= RADIX4_MAX_BITS);
+  assert(tmp1.size() >= n * sizeof(T));
+  assert(tmp2.size() >= n * sizeof(int));
+  T*   xx = tmp1.get<T>();
+  int* oo = tmp2.get<int>();
+  int shift = K > B? K - B : 0;
+  int histogram[radix_pass<T, B>::NRADIXES];
+
+  // The prefix sum is part of radix_pass::histogram(), so it is not timed
+  // separately here.
+  RADIX_PROFILE_START(t0);
+  radix_pass<T, B>::histogram(x, n, shift, histogram);
+  RADIX_PROFILE_ADD(HISTOGRAM, t0, n);
+  RADIX_PROFILE_START(t1);
+  radix_pass<T, B>::scatter(x, o, n, shift, histogram, xx, oo);
+  RADIX_PROFILE_ADD(SCATTER, t1, n);
+
+  if (shift) {
+    tmp1.push(x, n * sizeof(T));
+    tmp2.push(o, n * sizeof(int));
+    radix4_sort_buckets<T, B>(xx, oo, histogram, shift);
+    tmp2.pop();
+    tmp1.pop();
+  }
+  RADIX_PROFILE_START(t3);
+  std::memcpy(o, oo, n * sizeof(int));
+  RADIX_PROFILE_ADD(MEMCPY, t3, n);
+}
+
+
+// Table of radix_sort4_impl<T, B> kernels for B = 1 .. RADIX4_MAX_BITS,
+// generated at compile time.
+template <typename T>
+using radix4_fn_t = void(*)(T*, int*, int, int);
+
+template <typename T, int... I>
+static constexpr std::array<radix4_fn_t<T>, sizeof...(I)>
+make_radix4_table(std::integer_sequence<int, I...>) {
+  return {{ radix_sort4_impl<T, I + 1>... }};
+}
+
+template <typename T>
+static constexpr std::array<radix4_fn_t<T>, RADIX4_MAX_BITS> radix4_table =
+    make_radix4_table<T>(std::make_integer_sequence<int, RADIX4_MAX_BITS>());
+
+
+template <typename T>
+void radix_sort4(T* x, int* o, int n, int K, int nradixbits)
+{
+  assert(nradixbits >= 1 && nradixbits <= RADIX4_MAX_BITS);
+  radix4_table<T>[nradixbits - 1](x, o, n, K);
+}
+
+template void radix_sort4(uint8_t*,  int*, int, int, int);
+template void radix_sort4(uint16_t*, int*, int, int, int);
+template void radix_sort4(uint32_t*, int*, int, int, int);
+template void radix_sort4(uint64_t*, int*, int, int, int);
+
+
+
+
+//------------------------------------------------------------------------------
+// Indirect Radix Sort 4
+//------------------------------------------------------------------------------
+
+// The scatter and the bucket sorts of radix_sort4_indirect, with the keys
+// narrowed to type TO.
+template <typename T, typename TO, int B>
+static void radix4_indirect_scatter(const T* x, int* o, int n, int shift,
+                                    int* histogram)
+{
+  size_t xsize = n * sizeof(TO);
+  assert(tmp1.size() >= 2 * xsize);
+  assert(tmp2.size() >= n * sizeof(int));
+  TO*  xx = tmp1.get<TO>();
+  int* oo = tmp2.get<int>();
+  RADIX_PROFILE_START(t1);
+  radix_pass<T, B>::scatter_indirect(x, o, n, shift, histogram, xx, oo);
+  RADIX_PROFILE_ADD(SCATTER, t1, n);
+
+  // The rows in `o` were copied into `oo`, so `o` is free to serve as the
+  // scratch of the bucket sorts, together with the rest of tmp1.
+  if (shift) {
+    tmp1.push(xx + n, tmp1.size() - xsize);
+    tmp2.push(o, n * sizeof(int));
+    radix4_sort_buckets<TO, B>(xx, oo, histogram, shift);
+    tmp2.pop();
+    tmp1.pop();
+  }
+  RADIX_PROFILE_START(t3);
+  std::memcpy(o, oo, n * sizeof(int));
+  RADIX_PROFILE_ADD(MEMCPY, t3, n);
+}
+
+
+// Radix sort of the keys x[o[i]], for a row-index vector `o` such as the one
+// of a filtered view. This is radix_sort4 with the gather of the keys folded
+// into its first pass: the histogram reads the keys through `o`, and the
+// scatter writes them out contiguously, reduced to their remaining `shift`
+// bits and stored in the narrowest type that holds them. All later passes
+// run over this compact copy.
+// Uses:
+//   tmp1 - 2*n elements of the compact key type (at most 2*n*sizeof(T))
+//   tmp2 - array of the same size as o (i.e. n*sizeof(int))
+//   tmp3 - only in the leaf sorts (at most (1<<16) * sizeof(int))
+template <typename T, int B>
+static void radix_sort4_indirect_impl(const T* x, int* o, int n, int K)
+{
+  static_assert(B >= 1 && B <= RADIX4_MAX_BITS);
+  int shift = K > B? K - B : 0;
+  int histogram[radix_pass<T, B>::NRADIXES];
+
+  RADIX_PROFILE_START(t0);
+  radix_pass<T, B>::histogram_indirect(x, o, n, shift, histogram);
+  RADIX_PROFILE_ADD(HISTOGRAM, t0, n);
+
+  if (shift <= 8) {
+    radix4_indirect_scatter<T, uint8_t, B>(x, o, n, shift, histogram);
+  } else if (shift <= 16) {
+    radix4_indirect_scatter<T, uint16_t, B>(x, o, n, shift, histogram);
+  } else if (shift <= 32) {
+    radix4_indirect_scatter<T, uint32_t, B>(x, o, n, shift, histogram);
+  } else {
+    radix4_indirect_scatter<T, uint64_t, B>(x, o, n, shift, histogram);
+  }
+}
+
+
+template <typename T>
+using radix4_indirect_fn_t = void(*)(const T*, int*, int, int);
+
+template <typename T, int... I>
+static constexpr std::array<radix4_indirect_fn_t<T>, sizeof...(I)>
+make_radix4_indirect_table(std::integer_sequence<int, I...>) {
+  return {{ radix_sort4_indirect_impl<T, I + 1>... }};
+}
+
+template <typename T>
+static constexpr std::array<radix4_indirect_fn_t<T>, RADIX4_MAX_BITS>
+radix4_indirect_table = make_radix4_indirect_table<T>(
+    std::make_integer_sequence<int, RADIX4_MAX_BITS>());
+
+
+template <typename T>
+void radix_sort4_indirect(const T* x, int* o, int n, int K, int nradixbits)
+{
+  assert(nradixbits >= 1 && nradixbits <= RADIX4_MAX_BITS);
+  radix4_indirect_table<T>[nradixbits - 1](x, o, n, K);
 }
 
-template void radix_sort3(uint8_t*,  int*, int, int);
-template void radix_sort3(uint16_t*, int*, int, int);
-template void radix_sort3(uint32_t*, int*, int, int);
-template void radix_sort3(uint64_t*, int*, int, int);
+template void radix_sort4_indirect(const uint8_t*,  int*, int, int, int);
+template void radix_sort4_indirect(const uint16_t*, int*, int, int, int);
+template void radix_sort4_indirect(const uint32_t*, int*, int, int, int);
+template void radix_sort4_indirect(const uint64_t*, int*, int, int, int);
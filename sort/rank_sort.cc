@@ -0,0 +1,313 @@
+//==============================================================================
+// Radix sort that computes ranks and the inverse ordering along the way
+//==============================================================================
+#include <algorithm>    // std::min
+#include <cstring>      // std::memset, std::memcpy
+#include <type_traits>  // std::is_integral
+#include <vector>       // std::vector
+#include <stdint.h>
+#include <assert.h>
+#include "thpool3/api.h"
+#include "sort.h"
+
+// Sub-arrays with at most this many elements are sorted with insert sort.
+static constexpr int RANK_INSERT_MAX = 24;
+
+// Number of bits processed by each MSD radix pass.
+static constexpr int RANK_RADIX_BITS = 8;
+
+// Sub-arrays whose keys have at most this many significant bits may be sorted
+// with a single counting pass, provided that there are enough elements to
+// amortize the cost of scanning the histogram.
+static constexpr int RANK_COUNT_BITS = 16;
+
+// Counting-pass histograms up to this many bits are kept on the stack.
+static constexpr int RANK_STACK_BITS = 10;
+
+// Arrays smaller than this are always ranked in a single thread.
+static constexpr int RANK_PARALLEL_MIN = 1 << 16;
+
+
+template <int M>
+struct rank_ctx {
+  rank_t<M>* ranks;
+  int* inv;
+  int ndistinct;
+};
+
+
+// Record a group of `c` equal elements whose final positions in the sorted
+// order are `pos .. pos+c-1`. The row indices of these elements are taken
+// from `src` and written into `dst`, so that the ranks and the inverse
+// ordering are filled in the same pass that stores the final ordering.
+template <int M>
+static inline void emit_group(const int* src, int* dst, int c, int pos,
+                              rank_ctx<M>* ctx)
+{
+  rank_t<M> r;
+  if constexpr(M == RANK_DENSE)   r = ++ctx->ndistinct;
+  if constexpr(M == RANK_MIN)     r = pos + 1;
+  if constexpr(M == RANK_MAX)     r = pos + c;
+  if constexpr(M == RANK_AVERAGE) r = pos + 0.5 * (c + 1);
+  rank_t<M>* ranks = ctx->ranks;
+  int* inv = ctx->inv;
+  for (int j = 0; j < c; j++) {
+    int row = src[j];
+    dst[j] = row;
+    ranks[row] = r;
+    inv[row] = pos + j;
+  }
+}
+
+
+// Sort the array `x` of `n` elements each having at most `K` significant
+// bits, and rank them. The final ordering is stored back into `o`. Arrays
+// `xs` and `os` are the scratch space of the same size as `x` and `o`. The
+// elements of `x` end up at positions `pos .. pos+n-1` in the global ordering.
+//
+// The ranks are computed from the group boundaries that the radix recursion
+// produces anyway: each bucket of the last counting pass (or each run of
+// equal elements in an insert-sorted leaf) is exactly a group of ties.
+template <typename T, int M>
+static void rank_recurse(T* x, int* o, T* xs, int* os, int n, int K, int pos,
+                         rank_ctx<M>* ctx)
+{
+  if (n <= RANK_INSERT_MAX) {
+    insert_sort0<T>(x, o, n, K);
+    for (int i = 0; i < n; ) {
+      int j = i + 1;
+      while (j < n && x[j] == x[i]) j++;
+      emit_group<M>(o + i, o + i, j - i, pos + i, ctx);
+      i = j;
+    }
+    return;
+  }
+
+  if (K <= RANK_RADIX_BITS || (K <= RANK_COUNT_BITS && n >= (1 << K) / 4)) {
+    int nradixes = 1 << K;
+    int stack_histogram[1 << RANK_STACK_BITS];
+    std::vector<int> heap_histogram;
+    int* histogram = stack_histogram;
+    if (K > RANK_STACK_BITS) {
+      heap_histogram.resize(nradixes);
+      histogram = heap_histogram.data();
+    }
+    std::memset(histogram, 0, nradixes * sizeof(int));
+    for (int i = 0; i < n; i++) {
+      histogram[x[i]]++;
+    }
+    int cumsum = 0;
+    for (int i = 0; i < nradixes; i++) {
+      int h = histogram[i];
+      histogram[i] = cumsum;
+      cumsum += h;
+    }
+    for (int i = 0; i < n; i++) {
+      int k = histogram[x[i]]++;
+      os[k] = o[i];
+    }
+    // Now `histogram[v]` is the end of the group of elements equal to `v`
+    int start = 0;
+    for (int i = 0; i < nradixes; i++) {
+      int end = histogram[i];
+      if (end == start) continue;
+      emit_group<M>(os + start, o + start, end - start, pos + start, ctx);
+      start = end;
+    }
+    return;
+  }
+
+  int nbits = K > 2 * RANK_RADIX_BITS ? RANK_RADIX_BITS
+                                      : K - RANK_RADIX_BITS;
+  int nradixes = 1 << nbits;
+  int shift = K - nbits;
+  T mask = static_cast<T>((T(1) << shift) - 1);
+  int histogram[1 << RANK_RADIX_BITS];
+  std::memset(histogram, 0, nradixes * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    histogram[x[i] >> shift]++;
+  }
+  int cumsum = 0;
+  for (int i = 0; i < nradixes; i++) {
+    int h = histogram[i];
+    histogram[i] = cumsum;
+    cumsum += h;
+  }
+  for (int i = 0; i < n; i++) {
+    int k = histogram[x[i] >> shift]++;
+    xs[k] = static_cast<T>(x[i] & mask);
+    os[k] = o[i];
+  }
+
+  // Continue sorting each bucket, using `x` and `o` as the scratch space
+  int start = 0;
+  for (int i = 0; i < nradixes; i++) {
+    int end = histogram[i];
+    int nextn = end - start;
+    if (nextn == 1) {
+      emit_group<M>(os + start, o + start, 1, pos + start, ctx);
+    }
+    else if (nextn > 1) {
+      rank_recurse<T, M>(xs + start, os + start, x + start, o + start,
+                         nextn, shift, pos + start, ctx);
+      std::memcpy(o + start, os + start, nextn * sizeof(int));
+    }
+    start = end;
+  }
+}
+
+
+
+// Stable sort of `x` (as radix_sort1), which in addition computes `ranks` of
+// all elements and the inverse ordering `inv`, both indexed by the row numbers
+// in `o` (thus, `o` must contain a permutation of 0..n-1). The ranks are
+// 1-based, ties are resolved according to method `M`.
+//
+// Array `x` is used as scratch space, and its content is destroyed.
+// Uses:
+//   tmp1 - array of the same size as x (i.e. n*sizeof(T))
+//   tmp2 - array of the same size as o (i.e. n*sizeof(int))
+template <typename T, int M>
+void rank_sort(T* x, int* o, int n, int K, rank_t<M>* ranks, int* inv)
+{
+  static_assert(std::is_integral<T>::value);
+  static_assert(std::is_unsigned<T>::value);
+  assert(tmp1.size() >= n * sizeof(T));
+  assert(tmp2.size() >= n * sizeof(int));
+  rank_ctx<M> ctx { ranks, inv, 0 };
+  rank_recurse<T, M>(x, o, tmp1.get<T>(), tmp2.get<int>(), n, K, 0, &ctx);
+}
+
+
+// Parallel version of `rank_sort()`. The first radix pass is done jointly by
+// all threads (each thread builds histogram of its own chunk of data), after
+// which the top-level buckets are sorted and ranked independently.
+//
+// Dense ranks within each bucket are computed relative to the start of that
+// bucket, and then shifted by the number of distinct values in all preceding
+// buckets in an additional pass.
+template <typename T, int M>
+void rank_sort_parallel(T* x, int* o, int n, int K, rank_t<M>* ranks,
+                        int* inv)
+{
+  size_t nth = dt3::num_threads_in_pool();
+  if (n < RANK_PARALLEL_MIN || nth <= 1 || K <= RANK_RADIX_BITS) {
+    rank_sort<T, M>(x, o, n, K, ranks, inv);
+    return;
+  }
+  assert(tmp1.size() >= n * sizeof(T));
+  assert(tmp2.size() >= n * sizeof(int));
+  T*   xs = tmp1.get<T>();
+  int* os = tmp2.get<int>();
+  int nradixes = 1 << RANK_RADIX_BITS;
+  int shift = K - RANK_RADIX_BITS;
+  T mask = static_cast<T>((T(1) << shift) - 1);
+  size_t chunk = (static_cast<size_t>(n) + nth - 1) / nth;
+
+  std::vector<int> histograms(nth * nradixes, 0);
+  dt3::parallel_region(nth,
+    [&] {
+      size_t ith = dt3::this_thread_index();
+      size_t i0 = std::min(ith * chunk, size_t(n));
+      size_t i1 = std::min(i0 + chunk, size_t(n));
+      int* h = histograms.data() + ith * nradixes;
+      for (size_t i = i0; i < i1; i++) {
+        h[x[i] >> shift]++;
+      }
+    });
+
+  std::vector<int> bucket_starts(nradixes + 1);
+  int cumsum = 0;
+  for (int r = 0; r < nradixes; r++) {
+    bucket_starts[r] = cumsum;
+    for (size_t t = 0; t < nth; t++) {
+      int h = histograms[t * nradixes + r];
+      histograms[t * nradixes + r] = cumsum;
+      cumsum += h;
+    }
+  }
+  bucket_starts[nradixes] = cumsum;
+  assert(cumsum == n);
+
+  dt3::parallel_region(nth,
+    [&] {
+      size_t ith = dt3::this_thread_index();
+      size_t i0 = std::min(ith * chunk, size_t(n));
+      size_t i1 = std::min(i0 + chunk, size_t(n));
+      int* h = histograms.data() + ith * nradixes;
+      for (size_t i = i0; i < i1; i++) {
+        int k = h[x[i] >> shift]++;
+        xs[k] = static_cast<T>(x[i] & mask);
+        os[k] = o[i];
+      }
+    });
+
+  std::vector<int> ndistinct(nradixes, 0);
+  dt3::parallel_for_dynamic(nradixes,
+    [&](size_t r) {
+      int start = bucket_starts[r];
+      int nextn = bucket_starts[r + 1] - start;
+      if (nextn == 0) return;
+      rank_ctx<M> ctx { ranks, inv, 0 };
+      if (nextn == 1) {
+        emit_group<M>(os + start, o + start, 1, start, &ctx);
+      } else {
+        rank_recurse<T, M>(xs + start, os + start, x + start, o + start,
+                           nextn, shift, start, &ctx);
+        std::memcpy(o + start, os + start, nextn * sizeof(int));
+      }
+      ndistinct[r] = ctx.ndistinct;
+    });
+
+  if constexpr(M == RANK_DENSE) {
+    int offset = 0;
+    for (int r = 0; r < nradixes; r++) {
+      int d = ndistinct[r];
+      ndistinct[r] = offset;
+      offset += d;
+    }
+    dt3::parallel_for_dynamic(nradixes,
+      [&](size_t r) {
+        int offset = ndistinct[r];
+        if (offset == 0) return;
+        for (int k = bucket_starts[r]; k < bucket_starts[r + 1]; k++) {
+          ranks[o[k]] += offset;
+        }
+      });
+  }
+}
+
+
+template void rank_sort<uint8_t,  RANK_DENSE>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort<uint16_t, RANK_DENSE>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort<uint32_t, RANK_DENSE>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort<uint64_t, RANK_DENSE>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort<uint8_t,  RANK_MIN>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort<uint16_t, RANK_MIN>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort<uint32_t, RANK_MIN>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort<uint64_t, RANK_MIN>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort<uint8_t,  RANK_MAX>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort<uint16_t, RANK_MAX>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort<uint32_t, RANK_MAX>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort<uint64_t, RANK_MAX>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort<uint8_t,  RANK_AVERAGE>(uint8_t*,  int*, int, int, double*, int*);
+template void rank_sort<uint16_t, RANK_AVERAGE>(uint16_t*, int*, int, int, double*, int*);
+template void rank_sort<uint32_t, RANK_AVERAGE>(uint32_t*, int*, int, int, double*, int*);
+template void rank_sort<uint64_t, RANK_AVERAGE>(uint64_t*, int*, int, int, double*, int*);
+
+template void rank_sort_parallel<uint8_t,  RANK_DENSE>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort_parallel<uint16_t, RANK_DENSE>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint32_t, RANK_DENSE>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint64_t, RANK_DENSE>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint8_t,  RANK_MIN>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort_parallel<uint16_t, RANK_MIN>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint32_t, RANK_MIN>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint64_t, RANK_MIN>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint8_t,  RANK_MAX>(uint8_t*,  int*, int, int, int*, int*);
+template void rank_sort_parallel<uint16_t, RANK_MAX>(uint16_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint32_t, RANK_MAX>(uint32_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint64_t, RANK_MAX>(uint64_t*, int*, int, int, int*, int*);
+template void rank_sort_parallel<uint8_t,  RANK_AVERAGE>(uint8_t*,  int*, int, int, double*, int*);
+template void rank_sort_parallel<uint16_t, RANK_AVERAGE>(uint16_t*, int*, int, int, double*, int*);
+template void rank_sort_parallel<uint32_t, RANK_AVERAGE>(uint32_t*, int*, int, int, double*, int*);
+template void rank_sort_parallel<uint64_t, RANK_AVERAGE>(uint64_t*, int*, int, int, double*, int*);
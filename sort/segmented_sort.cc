@@ -0,0 +1,251 @@
+//==============================================================================
+// Segmented sort: sort many independent groups in a single call
+//==============================================================================
+#include <algorithm>    // std::min, std::max, std::sort, std::swap
+#include <cstring>      // std::memset, std::memcpy
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+#include "thpool3/api.h"
+#include "sort.h"
+
+// Segments of up to this many elements are sorted with a sorting network.
+static constexpr int SEG_NETWORK_MAX = 8;
+
+// Segments of up to this many elements are sorted with the insertion sort,
+// larger ones with the radix sort.
+static constexpr int SEG_INSERTION_MAX = 64;
+
+// Segments of up to this many elements are first tried with a single MSD
+// pass followed by an insertion sort (see seg_radix_sort).
+static constexpr int SEG_MSD_MAX = 4096;
+
+// Number of bits per pass of the segment radix sort. The histograms of all
+// the passes (at most 8 for 64-bit keys) fit on the stack.
+static constexpr int SEG_RADIX_BITS = 8;
+static constexpr int SEG_RADIX_MAX_PASSES = 8;
+
+// Number of tiny/small segments handed to a thread at a time.
+static constexpr size_t SEG_CHUNK = 1024;
+
+
+
+//------------------------------------------------------------------------------
+// Segment sorts
+//------------------------------------------------------------------------------
+
+// Branch-free compare-exchange of the adjacent elements i and i+1. The
+// elements are swapped only if the second one is strictly smaller, so the
+// network below is stable.
+template <typename T>
+static inline void seg_cmpswap(T* x, int* o, int i) {
+  T a = x[i], b = x[i + 1];
+  int oa = o[i], ob = o[i + 1];
+  bool s = b < a;
+  x[i]     = s? b : a;
+  x[i + 1] = s? a : b;
+  o[i]     = s? ob : oa;
+  o[i + 1] = s? oa : ob;
+}
+
+// Odd-even transposition network for N elements: N rounds of compare-
+// exchanges of adjacent elements, fully unrolled. The elements are loaded
+// into local arrays first, so that the whole network runs in registers.
+template <typename T, int N>
+static void seg_network(T* x, int* o) {
+  T xl[N];
+  int ol[N];
+  for (int i = 0; i < N; i++) {
+    xl[i] = x[i];
+    ol[i] = o[i];
+  }
+  for (int r = 0; r < N; r++) {
+    for (int i = r & 1; i + 1 < N; i += 2) {
+      seg_cmpswap(xl, ol, i);
+    }
+  }
+  for (int i = 0; i < N; i++) {
+    x[i] = xl[i];
+    o[i] = ol[i];
+  }
+}
+
+template <typename T>
+static void seg_tiny_sort(T* x, int* o, int n) {
+  switch (n) {
+    case 2: seg_network<T, 2>(x, o); break;
+    case 3: seg_network<T, 3>(x, o); break;
+    case 4: seg_network<T, 4>(x, o); break;
+    case 5: seg_network<T, 5>(x, o); break;
+    case 6: seg_network<T, 6>(x, o); break;
+    case 7: seg_network<T, 7>(x, o); break;
+    case 8: seg_network<T, 8>(x, o); break;
+    default: break;
+  }
+}
+
+
+// Radix sort of a single segment, on the keys relative to the smallest key
+// of the segment (so that groups with a narrow range of values need few
+// passes). `xs` and `os` are scratch arrays of `n` elements.
+//
+// Segments of up to SEG_MSD_MAX elements are scattered once by their top
+// log2(n) bits (at most SEG_RADIX_BITS), and then finished with an insertion
+// sort, which only moves elements within their buckets. This is skipped if
+// some bucket is too large for the insertion sort (skewed data). Otherwise the segment is
+// sorted with a stable LSD radix sort: all histograms are computed in a
+// single read, and the passes where every element falls into the same
+// bucket are skipped.
+template <typename T>
+static void seg_radix_sort(T* x, int* o, int n, T* xs, int* os) {
+  T lo = x[0], hi = x[0];
+  for (int i = 1; i < n; i++) {
+    lo = std::min(lo, x[i]);
+    hi = std::max(hi, x[i]);
+  }
+  if (lo == hi) return;
+  uint64_t range = static_cast<uint64_t>(hi - lo);
+  int nbits = 64 - __builtin_clzll(range);
+  int npasses = (nbits + SEG_RADIX_BITS - 1) / SEG_RADIX_BITS;
+  constexpr int NRADIXES = 1 << SEG_RADIX_BITS;
+  constexpr T MASK = static_cast<T>(NRADIXES - 1);
+
+  if (n <= SEG_MSD_MAX && npasses > 1) {
+    // About one bucket per element: fewer buckets for smaller segments,
+    // since clearing and scanning the histogram is a per-segment cost.
+    int mbits = std::min(31 - __builtin_clz(static_cast<unsigned>(n)),
+                         SEG_RADIX_BITS);
+    int nbuckets = 1 << mbits;
+    int shift = nbits - mbits;
+    int h[NRADIXES];
+    std::memset(h, 0, nbuckets * sizeof(int));
+    for (int i = 0; i < n; i++) {
+      h[static_cast<T>(x[i] - lo) >> shift]++;
+    }
+    if (*std::max_element(h, h + nbuckets) <= SEG_INSERTION_MAX) {
+      int cumsum = 0;
+      for (int r = 0; r < nbuckets; r++) {
+        int c = h[r];
+        h[r] = cumsum;
+        cumsum += c;
+      }
+      for (int i = 0; i < n; i++) {
+        int k = h[static_cast<T>(x[i] - lo) >> shift]++;
+        xs[k] = x[i];
+        os[k] = o[i];
+      }
+      std::memcpy(x, xs, n * sizeof(T));
+      std::memcpy(o, os, n * sizeof(int));
+      insert_sort0<T>(x, o, n, 0);
+      return;
+    }
+  }
+
+  int histograms[SEG_RADIX_MAX_PASSES][NRADIXES];
+  std::memset(histograms, 0, npasses * sizeof(histograms[0]));
+  for (int i = 0; i < n; i++) {
+    T v = static_cast<T>(x[i] - lo);
+    for (int p = 0; p < npasses; p++) {
+      histograms[p][(v >> (p * SEG_RADIX_BITS)) & MASK]++;
+    }
+  }
+
+  T* xsrc = x;    T* xdst = xs;
+  int* osrc = o;  int* odst = os;
+  for (int p = 0; p < npasses; p++) {
+    int* h = histograms[p];
+    int shift = p * SEG_RADIX_BITS;
+    if (h[((xsrc[0] - lo) >> shift) & MASK] == n) continue;
+    int cumsum = 0;
+    for (int r = 0; r < NRADIXES; r++) {
+      int c = h[r];
+      h[r] = cumsum;
+      cumsum += c;
+    }
+    for (int i = 0; i < n; i++) {
+      int k = h[static_cast<T>(xsrc[i] - lo) >> shift & MASK]++;
+      xdst[k] = xsrc[i];
+      odst[k] = osrc[i];
+    }
+    std::swap(xsrc, xdst);
+    std::swap(osrc, odst);
+  }
+  if (xsrc != x) {
+    std::memcpy(x, xsrc, n * sizeof(T));
+    std::memcpy(o, osrc, n * sizeof(int));
+  }
+}
+
+
+
+//------------------------------------------------------------------------------
+// Segmented sort
+//------------------------------------------------------------------------------
+
+// Sort each of the `ngroups` segments [offsets[g], offsets[g + 1]) of `x`
+// independently (and stably), permuting `o` along with the keys. The
+// segments are binned by size, and each bin is processed with the method
+// that suits it best:
+//   - up to SEG_NETWORK_MAX elements: sorting networks, in static chunks;
+//   - up to SEG_INSERTION_MAX: insertion sort, in static chunks;
+//   - larger: radix sort (see seg_radix_sort), one segment per task,
+//     largest first.
+// Uses:
+//   tmp1 - array of the same size as x (i.e. offsets[ngroups]*sizeof(T))
+//   tmp2 - array of the same size as o (i.e. offsets[ngroups]*sizeof(int))
+// Each segment uses the part of tmp1/tmp2 at its own offsets, so the
+// segments can be sorted concurrently without any per-thread scratch.
+template <typename T>
+void segmented_sort(T* x, int* o, const int* offsets, int ngroups, int)
+{
+  if (ngroups <= 0) return;
+  int n = offsets[ngroups];
+  assert(tmp1.size() >= n * sizeof(T));
+  assert(tmp2.size() >= n * sizeof(int));
+  T*   xs = tmp1.get<T>();
+  int* os = tmp2.get<int>();
+
+  std::vector<int> tiny, small, large;
+  for (int g = 0; g < ngroups; g++) {
+    int size = offsets[g + 1] - offsets[g];
+    if (size <= 1) continue;
+    if (size <= SEG_NETWORK_MAX) tiny.push_back(g);
+    else if (size <= SEG_INSERTION_MAX) small.push_back(g);
+    else large.push_back(g);
+  }
+
+  if (!tiny.empty()) {
+    dt3::parallel_for_static(tiny.size(), SEG_CHUNK,
+      [&](size_t i) {
+        int g = tiny[i];
+        int start = offsets[g];
+        seg_tiny_sort<T>(x + start, o + start, offsets[g + 1] - start);
+      });
+  }
+  if (!small.empty()) {
+    dt3::parallel_for_static(small.size(), SEG_CHUNK / 16,
+      [&](size_t i) {
+        int g = small[i];
+        int start = offsets[g];
+        insert_sort0<T>(x + start, o + start, offsets[g + 1] - start, 0);
+      });
+  }
+  if (!large.empty()) {
+    std::sort(large.begin(), large.end(),
+      [=](int a, int b) {
+        return offsets[a + 1] - offsets[a] > offsets[b + 1] - offsets[b];
+      });
+    dt3::parallel_for_dynamic(large.size(),
+      [&](size_t i) {
+        int g = large[i];
+        int start = offsets[g];
+        seg_radix_sort<T>(x + start, o + start, offsets[g + 1] - start,
+                          xs + start, os + start);
+      });
+  }
+}
+
+template void segmented_sort(uint8_t*,  int*, const int*, int, int);
+template void segmented_sort(uint16_t*, int*, const int*, int, int);
+template void segmented_sort(uint32_t*, int*, const int*, int, int);
+template void segmented_sort(uint64_t*, int*, const int*, int, int);
@@ -2,6 +2,7 @@
 #define MICROBENCH_SORT_H
 #include <new>
 #include <stack>
+#include <type_traits>
 #include <stdint.h>
 
 template <typename T>
@@ -41,11 +42,97 @@ void std_sort(xoitem<T>* xo, int n, int);
 template <typename T, bool masked = false>
 void count_sort0(T* x, int* o, int n, int K);
 
+int cat_sort_ranks(const char* const* dict, int ndict, int* rank);
+
+template <typename T>
+void cat_sort0(T* x, int* o, int n, const int* rank, int nranks);
+
 template <typename T>
-void radix_sort1(T* x, int* o, int n, int K);
+void radix_sort1(T* x, int* o, int n, int K, int nradixbits);
+
+// Methods for resolving ties when computing ranks: DENSE is the SQL's
+// DENSE_RANK(), MIN is RANK(), MAX and AVERAGE are as in pandas' rank().
+enum RankMethod { RANK_DENSE, RANK_MIN, RANK_MAX, RANK_AVERAGE };
+
+template <int M>
+using rank_t = typename std::conditional<M == RANK_AVERAGE, double, int>::type;
+
+template <typename T, int M>
+void rank_sort(T* x, int* o, int n, int K, rank_t<M>* ranks, int* inv);
+
+template <typename T, int M>
+void rank_sort_parallel(T* x, int* o, int n, int K, rank_t<M>* ranks, int* inv);
+
+template <typename T>
+void radix_sort3(T* x, int* o, int n, int K, int nradixbits);
+
+template <typename T>
+void radix_sort4(T* x, int* o, int n, int K, int nradixbits);
+
+// Indirect sorts: sort the row indices `o` (for example the rows of a
+// filtered view) by the keys x[o[i]], without gathering the keys into a
+// separate array first. `x` is only read. The keys are fetched with software
+// prefetches this many rows ahead.
+static constexpr int INDIRECT_PREFETCH_DISTANCE = 16;
+
+template <typename T>
+void radix_sort4_indirect(const T* x, int* o, int n, int K, int nradixbits);
+
+template <typename T, int P>
+void merge_sort0_indirect(const T* x, int* o, int n, int K);
+
+// A column that is reordered together with the sort keys; `elemsize` must be
+// 1, 2, 4 or 8.
+struct payload_col {
+  void* data;
+  int elemsize;
+};
+
+static constexpr int MAX_PAYLOAD_COLS = 8;
+
+template <typename T>
+void payload_sort(T* x, int* o, int n, int K, payload_col* cols, int ncols);
+
+// Number of bytes of tmp3 needed by `payload_sort()`.
+size_t payload_scratch_size(int n, const payload_col* cols, int ncols);
+
+// Reorder the columns after a sort: `dst[c][i] = src[c][o[i]]`, on up to
+// `nthreads` threads of the dt3 pool (0 = all of them).
+void gather_cols(const int* o, int n, const payload_col* src,
+                 payload_col* dst, int ncols, size_t nthreads = 0);
+
+// A column of `n` unsigned values of `width` bits (1 to 32) each, packed LSB
+// first into 32-bit words: value i occupies bits [i*width, (i+1)*width). The
+// values form blocks of PACK_BLOCK, each starting on a word boundary, and the
+// buffer ends with a word of padding; see packed_words().
+static constexpr int PACK_BLOCK = 32;
+
+struct packed_column {
+  const uint32_t* words;
+  int n;
+  int width;
+};
+
+size_t packed_words(int n, int width);
+void pack_bits(const uint32_t* x, int n, int width, uint32_t* words);
+void unpack_bits(const packed_column& col, uint32_t* x);
+void packed_sort(const packed_column& col, uint32_t* x, int* o);
+
+// A run-length encoded column: `nruns` runs, run r consisting of `lengths[r]`
+// rows with the value `values[r]`.
+struct rle_column {
+  const uint32_t* values;
+  const int* lengths;
+  int nruns;
+};
 
+void rle_decode(const rle_column& col, uint32_t* x);
+void rle_sort(const rle_column& col, int K, uint32_t* x, int* o);
+
+// Sort each of the `ngroups` segments [offsets[g], offsets[g+1]) of x
+// independently, e.g. the rows within each group after a groupby.
 template <typename T>
-void radix_sort3(T* x, int* o, int n, int K);
+void segmented_sort(T* x, int* o, const int* offsets, int ngroups, int K);
 
 template <typename T, int P>
 void merge_sort0(T* x, int* o, int N, int K);
@@ -57,6 +144,70 @@ void mergesort1(int* x, int* o, int n, int K);
 
 void timsort(int* x, int* o, int n, int K);
 
+// Unstable in-place sort (pattern-defeating quick sort with branchless block
+// partitioning and a heap sort fallback). Uses no scratch memory; `o` may be
+// nullptr when only the keys need to be sorted.
+template <typename T>
+void quick_sort(T* x, int* o, int n, int K);
+
+
+
+// Distributions of the input data generated by the benchmark
+enum Distribution {
+  DIST_UNIFORM, DIST_ZIPF, DIST_EQUAL, DIST_FEW_UNIQUE, DIST_SORTED,
+  DIST_REVERSED, DIST_NOISY_SORTED, DIST_SAWTOOTH, DIST_CLUSTERED, NDISTS
+};
+
+const char* dist_name(int dist);
+int dist_from_name(const char* name);
+
+template <typename T>
+void generate_data(T* x, int n, int K, int dist, uint64_t seed);
+
+
+// A column of unsigned integer keys memory-mapped from a binary file. The
+// file starts with a 16-byte header: the magic bytes "SCOL", the element
+// size (uint32: 1, 2, 4 or 8) and the number of rows (uint64), followed by
+// the raw little-endian values.
+static constexpr int COLFILE_HEADER_SIZE = 16;
+
+struct column_file {
+  const void* data;
+  int elemsize;
+  int nrows;
+  void* map;
+  size_t maplen;
+};
+
+bool open_column_file(const char* path, column_file* cf);
+void close_column_file(column_file* cf);
+int column_sig_bits(const column_file* cf);
+
+
+// Peak memory bandwidth of the host, in GB/s of bytes read plus bytes
+// written, measured with a sequential copy and with a 256-way scatter (the
+// access pattern of a radix pass) over two buffers of `nbytes` each.
+struct bandwidth_peak {
+  double copy;
+  double scatter;
+};
+
+bandwidth_peak probe_bandwidth(size_t nbytes);
+
+
+// Large buffers (sort data and scratch memory) can be backed by 2MB huge
+// pages, which greatly reduces the number of TLB misses in random scatters
+// over arrays of hundreds of megabytes. THP requests transparent huge pages
+// via madvise(); HUGETLB uses MAP_HUGETLB, falling back to THP when the
+// system has no huge pages reserved. Buffers smaller than 2MB always come
+// from malloc().
+enum HugePages { HUGE_PAGES_OFF, HUGE_PAGES_THP, HUGE_PAGES_HUGETLB };
+
+void set_huge_pages(int mode);
+int get_huge_pages();
+void* large_alloc(size_t sz);
+void* large_realloc(void* ptr, size_t sz);
+void large_free(void* ptr);
 
 
 struct omem {
@@ -68,7 +219,7 @@ struct omem {
   omem() : ptr(nullptr), n(0) {}
   ~omem() {
     while (!ptr_stack.empty()) pop();
-    free(ptr);
+    large_free(ptr);
   }
 
   size_t size() const {
@@ -83,7 +234,7 @@ struct omem {
   void ensure_size(size_t sz) {
     if (n > sz) return;
     n = sz;
-    ptr = realloc(ptr, sz);
+    ptr = large_realloc(ptr, sz);
     if (ptr == nullptr) throw std::bad_alloc();
   }
 
@@ -103,7 +254,6 @@ struct omem {
 };
 
 
-extern int tmp0;
 extern omem tmp1;
 extern omem tmp2;
 extern omem tmp3;
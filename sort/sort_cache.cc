@@ -0,0 +1,156 @@
+//==============================================================================
+// Cache of sort results
+//==============================================================================
+#include <atomic>       // std::atomic
+#include <cstring>      // std::memcpy
+#include <assert.h>
+#include "sort.h"
+#include "sort_cache.h"
+
+
+
+//------------------------------------------------------------------------------
+// sort_cache
+//------------------------------------------------------------------------------
+
+uint64_t new_column_id() {
+  static std::atomic<uint64_t> last_id {0};
+  return ++last_id;
+}
+
+
+sort_cache::sort_cache(size_t capacity_bytes)
+  : capacity(capacity_bytes), used(0), stats{0, 0, 0, 0} {}
+
+
+sort_cache::result_ptr sort_cache::find(const sort_cache_key& key) {
+  auto it = index.find(key);
+  if (it == index.end()) return nullptr;
+  lru.splice(lru.begin(), lru, it->second);
+  return it->second->second;
+}
+
+
+void sort_cache::insert(const sort_cache_key& key, result_ptr res) {
+  auto it = index.find(key);
+  if (it != index.end()) erase(it->second);
+  size_t sz = res->memory_size();
+  if (sz > capacity) return;
+  while (used + sz > capacity) {
+    erase(std::prev(lru.end()));
+    stats.evictions++;
+  }
+  lru.emplace_front(key, std::move(res));
+  index[key] = lru.begin();
+  used += sz;
+}
+
+
+void sort_cache::clear() {
+  lru.clear();
+  index.clear();
+  used = 0;
+}
+
+
+void sort_cache::erase(std::list<entry>::iterator it) {
+  used -= it->second->memory_size();
+  index.erase(it->first);
+  lru.erase(it);
+}
+
+
+
+//------------------------------------------------------------------------------
+// cached_sort
+//------------------------------------------------------------------------------
+
+// Sort the rows [row0, row0 + n) of the column `x`: on return `keys` and
+// `order` hold their keys and row numbers in the sorted order.
+template <typename T>
+static void sort_rows(const T* x, int row0, int n, int K, T* keys, int* order)
+{
+  std::memcpy(keys, x + row0, n * sizeof(T));
+  for (int i = 0; i < n; i++) order[i] = row0 + i;
+  payload_sort<T>(keys, order, n, K, nullptr, 0);
+}
+
+
+// Offsets of the groups of equal keys within the sorted `res->keys`.
+template <typename T>
+static void find_groups(sort_result* res) {
+  const T* keys = reinterpret_cast<const T*>(res->keys.data());
+  int n = res->nrows();
+  res->offsets.assign(1, 0);
+  for (int i = 1; i < n; i++) {
+    if (keys[i] != keys[i - 1]) res->offsets.push_back(i);
+  }
+  if (n) res->offsets.push_back(n);
+}
+
+
+// Merge the `m` sorted rows `bkeys` / `border` into the result `prev`. The
+// rows of `prev` precede the new rows in the column, so taking them first
+// on ties keeps the sort stable.
+template <typename T>
+static void merge_appended(const sort_result& prev, const T* bkeys,
+                           const int* border, int m, sort_result* res)
+{
+  int n0 = prev.nrows();
+  const T* akeys = reinterpret_cast<const T*>(prev.keys.data());
+  const int* aorder = prev.order.data();
+  T* keys = reinterpret_cast<T*>(res->keys.data());
+  int* order = res->order.data();
+  int i = 0, j = 0, k = 0;
+  while (i < n0 && j < m) {
+    bool a = akeys[i] <= bkeys[j];
+    keys[k] = a? akeys[i] : bkeys[j];
+    order[k] = a? aorder[i] : border[j];
+    i += a;
+    j += !a;
+    k++;
+  }
+  std::memcpy(keys + k, akeys + i, (n0 - i) * sizeof(T));
+  std::memcpy(order + k, aorder + i, (n0 - i) * sizeof(int));
+  k += n0 - i;
+  std::memcpy(keys + k, bkeys + j, (m - j) * sizeof(T));
+  std::memcpy(order + k, border + j, (m - j) * sizeof(int));
+}
+
+
+template <typename T>
+sort_cache::result_ptr cached_sort(sort_cache& cache, uint64_t column,
+                                   const T* x, int n, int K, uint64_t version)
+{
+  sort_cache_key key {column, version, static_cast<int>(sizeof(T)), K};
+  sort_cache::result_ptr prev = cache.find(key);
+  if (prev && prev->nrows() == n) {
+    cache.stats.hits++;
+    return prev;
+  }
+
+  auto res = std::make_shared<sort_result>();
+  res->order.resize(n);
+  res->keys.resize(n * sizeof(T));
+  if (prev && prev->nrows() < n) {
+    cache.stats.appends++;
+    int n0 = prev->nrows();
+    int m = n - n0;
+    std::vector<T> bkeys(m);
+    std::vector<int> border(m);
+    sort_rows<T>(x, n0, m, K, bkeys.data(), border.data());
+    merge_appended<T>(*prev, bkeys.data(), border.data(), m, res.get());
+  } else {
+    cache.stats.misses++;
+    sort_rows<T>(x, 0, n, K, reinterpret_cast<T*>(res->keys.data()),
+                 res->order.data());
+  }
+  find_groups<T>(res.get());
+  cache.insert(key, res);
+  return res;
+}
+
+template sort_cache::result_ptr cached_sort(sort_cache&, uint64_t, const uint8_t*,  int, int, uint64_t);
+template sort_cache::result_ptr cached_sort(sort_cache&, uint64_t, const uint16_t*, int, int, uint64_t);
+template sort_cache::result_ptr cached_sort(sort_cache&, uint64_t, const uint32_t*, int, int, uint64_t);
+template sort_cache::result_ptr cached_sort(sort_cache&, uint64_t, const uint64_t*, int, int, uint64_t);
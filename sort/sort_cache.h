@@ -0,0 +1,121 @@
+//==============================================================================
+// Cache of sort results
+//==============================================================================
+#ifndef MICROBENCH_SORT_CACHE_H
+#define MICROBENCH_SORT_CACHE_H
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// Identifies the sort of a column: the id of the column, its version, and
+// the options of the sort. The id comes from `new_column_id()`, and is never
+// reused, even after the column is freed (unlike the address of its buffer).
+// The owner of the column must bump the version whenever existing rows
+// change; appending rows to the end of the column keeps the version (see
+// cached_sort).
+struct sort_cache_key {
+  uint64_t column;
+  uint64_t version;
+  int elemsize;
+  int K;
+
+  bool operator==(const sort_cache_key& other) const {
+    return column == other.column && version == other.version &&
+           elemsize == other.elemsize && K == other.K;
+  }
+};
+
+// A new column id, different from all the ids returned before.
+uint64_t new_column_id();
+
+struct sort_cache_key_hash {
+  size_t operator()(const sort_cache_key& k) const {
+    uint64_t h = k.column;
+    h = h * 0x9E3779B97F4A7C15ULL ^ k.version;
+    h = h * 0x9E3779B97F4A7C15ULL ^ static_cast<uint64_t>(k.elemsize * 128 + k.K);
+    return static_cast<size_t>(h ^ (h >> 29));
+  }
+};
+
+// Result of a stable sort of the first `nrows()` rows of a column: the
+// ordering, and the offsets of the groups of equal keys within it (the
+// start of each group, plus `nrows()` at the end). The sorted keys are kept
+// as well, so that rows appended later can be merged in with sequential
+// reads only.
+struct sort_result {
+  std::vector<int> order;
+  std::vector<int> offsets;
+  std::vector<char> keys;
+
+  int nrows() const { return static_cast<int>(order.size()); }
+  int ngroups() const { return static_cast<int>(offsets.size()) - 1; }
+
+  size_t memory_size() const {
+    return sizeof(*this) + keys.capacity() +
+           (order.capacity() + offsets.capacity()) * sizeof(int);
+  }
+};
+
+
+// Bounded LRU cache of sort results. The memory used by the results is
+// accounted for, and the least recently used ones are evicted to keep it
+// within `capacity` bytes; a result larger than the capacity is not cached
+// at all. Results are shared, so the ones handed out stay valid after their
+// eviction.
+class sort_cache {
+  public:
+    using result_ptr = std::shared_ptr<const sort_result>;
+
+    struct stats_t {
+      size_t hits, appends, misses, evictions;
+    };
+
+  private:
+    using entry = std::pair<sort_cache_key, result_ptr>;
+    std::list<entry> lru;  // most recently used first
+    std::unordered_map<sort_cache_key, std::list<entry>::iterator,
+                       sort_cache_key_hash> index;
+    size_t capacity;
+    size_t used;
+
+  public:
+    stats_t stats;
+
+    explicit sort_cache(size_t capacity_bytes);
+
+    // Returns the cached result for `key` (of any number of rows), or
+    // nullptr; a found result becomes the most recently used one.
+    result_ptr find(const sort_cache_key& key);
+
+    // Stores `res` under `key`, replacing the previous result if any.
+    void insert(const sort_cache_key& key, result_ptr res);
+
+    void clear();
+    size_t size() const { return lru.size(); }
+    size_t memory_used() const { return used; }
+
+  private:
+    void erase(std::list<entry>::iterator it);
+};
+
+
+// Stable sort of the first `n` rows of column `x`, whose id is `column`,
+// through the cache.
+//   - hit: the cached result has `n` rows, and is returned as is;
+//   - append: the cached result has fewer rows, i.e. rows were appended to
+//     the column since. Only the new rows are sorted, and then merged into
+//     the cached ordering;
+//   - miss: the column is sorted in full.
+// The sorts are stable LSD radix sorts (payload_sort) of a copy of the keys;
+// `x` is never written to. Uses:
+//   tmp1 - array of n elements of type T
+//   tmp2 - array of n ints
+template <typename T>
+sort_cache::result_ptr cached_sort(sort_cache& cache, uint64_t column,
+                                   const T* x, int n, int K, uint64_t version);
+
+
+#endif